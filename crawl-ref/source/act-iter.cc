@@ -2,18 +2,52 @@
 
 #include "act-iter.h"
 
+#include "coordit.h"
 #include "env.h"
 #include "losglobal.h"
 
+near_monsters::near_monsters(coord_def c, los_type los)
+    : end(0)
+{
+    // Nothing outside LOS range can pass cell_see_cell(), except for
+    // LOS_NONE, which takes everyone.
+    if (los == LOS_NONE)
+    {
+        for (int i = 0; i < env.mons_used; ++i)
+            mons.set(i);
+        end = env.mons_used;
+        return;
+    }
+
+    for (rectangle_iterator ri(c, LOS_MAX_RANGE, true); ri; ++ri)
+    {
+        const int mi = env.mgrid(*ri);
+        if (mi < MAX_MONSTERS)
+        {
+            mons.set(mi);
+            end = max(end, mi + 1);
+        }
+    }
+}
+
+// The first candidate after index i, or MAX_MONSTERS if there are no more.
+int near_monsters::next(int i) const
+{
+    while (++i < end)
+        if (mons[i])
+            return i;
+    return MAX_MONSTERS;
+}
+
 actor_near_iterator::actor_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(-1)
+    : center(c), _los(los), viewer(nullptr), candidates(c, los), i(-1)
 {
     if (!valid(&you))
         advance();
 }
 
 actor_near_iterator::actor_near_iterator(const actor* a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(-1)
+    : center(a->pos()), _los(los), viewer(a), candidates(center, los), i(-1)
 {
     if (!valid(&you))
         advance();
@@ -64,7 +98,7 @@ bool actor_near_iterator::valid(const actor* a) const
 void actor_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = candidates.next(i)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -72,18 +106,16 @@ void actor_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_near_iterator::monster_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(0)
+    : center(c), _los(los), viewer(nullptr), candidates(c, los), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
 monster_near_iterator::monster_near_iterator(const actor *a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(0)
+    : center(a->pos()), _los(los), viewer(a), candidates(center, los), i(-1)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    advance();
     begin_point = i;
 }
 
@@ -154,7 +186,7 @@ bool monster_near_iterator::valid(const monster* a) const
 void monster_near_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
+         if ((i = candidates.next(i)) >= MAX_MONSTERS)
              return;
     while (!valid(**this));
 }
@@ -162,10 +194,9 @@ void monster_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_iterator::monster_iterator()
-    : i(0)
+    : i(-1)
 {
-    while (i < MAX_MONSTERS && !env.mons[i].alive())
-        i++;
+    advance();
 }
 
 monster_iterator::operator bool() const
@@ -188,9 +219,7 @@ monster* monster_iterator::operator->() const
 
 monster_iterator& monster_iterator::operator++()
 {
-    while (++i < MAX_MONSTERS)
-        if (env.mons[i].alive())
-            break;
+    advance();
     return *this;
 }
 
@@ -201,10 +230,14 @@ monster_iterator monster_iterator::operator++(int)
     return copy;
 }
 
+// Monsters only ever live below env.mons_used, so stop there.
 void monster_iterator::advance()
 {
     do
-         if (++i >= MAX_MONSTERS)
-             return;
+        if (++i >= env.mons_used)
+        {
+            i = MAX_MONSTERS;
+            return;
+        }
     while (!(*this)->alive());
 }
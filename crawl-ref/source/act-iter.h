@@ -5,8 +5,23 @@
 
 #pragma once
 
+#include "bitary.h"
 #include "los-type.h"
 
+// The monsters in range of a near iterator, found through the monster grid
+// and kept in index order so iteration matches a scan of env.mons.
+class near_monsters
+{
+public:
+    near_monsters(coord_def c, los_type los);
+
+    int next(int i) const;
+
+private:
+    FixedBitVector<MAX_MONSTERS> mons;
+    int end;
+};
+
 class actor_near_iterator
 {
 public:
@@ -23,6 +38,7 @@ protected:
     const coord_def center;
     los_type _los;
     const actor* viewer;
+    near_monsters candidates;
     int i;
 
     bool valid(const actor* a) const;
@@ -49,6 +65,7 @@ protected:
     const coord_def center;
     los_type _los;
     const actor* viewer;
+    near_monsters candidates;
     int i;
     int begin_point;
 
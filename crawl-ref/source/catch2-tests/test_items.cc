@@ -1,15 +1,19 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch.hpp"
 
 #include "AppHdr.h"
 
 #include "artefact.h"
 #include "art-enum.h"
+#include "env.h"
+#include "free-slots.h"
 #include "items.h"
 #include "item-prop.h"
 #include "item-prop-enum.h"
 #include "invent.h"
 #include "player-equip.h"
 #include "potion-type.h"
+#include "state.h"
 
 #include "test_player_fixture.h"
 
@@ -214,3 +218,76 @@ TEST_CASE("Test all_item_subtypes() does include items for each category",
     REQUIRE(all_item_subtypes(OBJ_GOLD).size() > 0);
     REQUIRE(all_item_subtypes(OBJ_RUNES).size() > 0);
 }
+
+TEST_CASE("free_slot_cache hands out each free slot once", "[single-file]") {
+    bool used[16] = { false, false, true, false, true };
+    const auto is_free = [&used](int i) { return !used[i]; };
+    free_slot_cache<16> cache;
+
+    // Lowest first, skipping slots that were already in use.
+    REQUIRE(cache.take(16, is_free) == 0);
+    used[0] = true;
+    REQUIRE(cache.take(16, is_free) == 1);
+    used[1] = true;
+    REQUIRE(cache.take(16, is_free) == 3);
+    used[3] = true;
+
+    // Slots filled behind the cache's back are skipped...
+    used[5] = true;
+    REQUIRE(cache.take(16, is_free) == 6);
+    used[6] = true;
+
+    // ...and nothing at or above the limit is returned.
+    REQUIRE(cache.take(7, is_free) == -1);
+
+    // Once everything is used up, a rescan finds freed slots again.
+    for (int i = 0; i < 16; ++i)
+        used[i] = true;
+    REQUIRE(cache.take(16, is_free) == -1);
+    used[1] = false;
+    REQUIRE(cache.take(16, is_free) == 1);
+}
+
+static void _churn_items(int count)
+{
+    vector<int> slots;
+    for (int i = 0; i < count; ++i)
+    {
+        const int slot = get_mitm_slot();
+        REQUIRE(slot != NON_ITEM);
+        REQUIRE(!env.item[slot].defined());
+        env.item[slot].base_type = OBJ_POTIONS;
+        env.item[slot].quantity = 1;
+        slots.push_back(slot);
+    }
+    for (int slot : slots)
+        destroy_item(slot, true);
+}
+
+TEST_CASE_METHOD( MockPlayerYouTestsFixture,
+                  "get_mitm_slot returns unused slots", "[single-file]" ) {
+    _churn_items(MAX_ITEMS / 2);
+    _churn_items(MAX_ITEMS / 2);
+
+    // Level generation always takes the lowest unused slot.
+    unwind_bool gen(crawl_state.generating_level, true);
+    REQUIRE(get_mitm_slot() == 0);
+}
+
+TEST_CASE_METHOD( MockPlayerYouTestsFixture,
+                  "Benchmark item slot churn", "[.][benchmark]" ) {
+    // Keep most of env.item in use, as on a cluttered level.
+    for (int i = 0; i < MAX_ITEMS * 3 / 4; ++i)
+    {
+        env.item[i].base_type = OBJ_GOLD;
+        env.item[i].quantity = 1;
+    }
+
+    BENCHMARK("allocate and free 100 items")
+    {
+        _churn_items(100);
+    };
+
+    for (int i = 0; i < MAX_ITEMS; ++i)
+        destroy_item(i, true);
+}
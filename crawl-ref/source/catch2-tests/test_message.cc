@@ -0,0 +1,42 @@
+#include "catch.hpp"
+
+#include "AppHdr.h"
+
+#include "message.h"
+#include "options.h"
+#include "pattern.h"
+#include "unwind.h"
+
+static unsigned int _colour_filter_hits(const string &pattern)
+{
+    for (const message_filter_stat &stat : message_filter_stats())
+        if (stat.option == "message_colour" && stat.pattern == pattern)
+            return stat.hits;
+    return 0;
+}
+
+TEST_CASE( "Compiled message filters agree with their regex",
+           "[single-file]" ) {
+    // The literal prefilter must not drop messages the regex itself
+    // matches, whichever way the engine reads the escapes.
+    const string word = "\\<orc\\>";
+    const text_pattern regex(word, true);
+    unsigned int expected = 0;
+    {
+        const message_colour_mapping mapping = { message_filter(word),
+                                                 MSGCOL_LIGHTRED };
+        unwind_var<vector<message_colour_mapping>> mappings(
+            Options.message_colour_mappings, { mapping });
+        ++Options.message_filter_generation;
+
+        for (const char *msg : { "The orc hits you.", "You see an <orc>." })
+        {
+            mprf("%s", msg);
+            if (regex.matches(msg))
+                ++expected;
+            REQUIRE( _colour_filter_hits(word) == expected );
+        }
+    }
+    ++Options.message_filter_generation;
+    REQUIRE( expected > 0 );
+}
@@ -0,0 +1,43 @@
+#include "catch.hpp"
+
+#include "AppHdr.h"
+#include "pattern.h"
+
+static vector<string> _literals(const string &regex)
+{
+    vector<string> runs;
+    REQUIRE( regex_literals(regex, runs) );
+    return runs;
+}
+
+TEST_CASE( "regex_literals finds required runs", "[single-file]" ) {
+    REQUIRE( _literals("orc warrior") == vector<string>{"orc warrior"} );
+    REQUIRE( _literals("Orc.*priest") == vector<string>{"orc", "priest"} );
+    REQUIRE( _literals("\\.xyz") == vector<string>{".xyz"} );
+
+    vector<string> runs;
+    REQUIRE( !regex_literals("orc|elf", runs) );
+}
+
+TEST_CASE( "regex_literals skips bracket expressions", "[single-file]" ) {
+    REQUIRE( _literals("[a-z]+foo") == vector<string>{"foo"} );
+    REQUIRE( _literals("[]x]hello") == vector<string>{"hello"} );
+    REQUIRE( _literals("[^]]world") == vector<string>{"world"} );
+    REQUIRE( _literals("[[:alpha:]]abc") == vector<string>{"abc"} );
+    REQUIRE( _literals("foo[[.-.]]bar") == vector<string>{"foo", "bar"} );
+
+    vector<string> runs;
+    REQUIRE( !regex_literals("[[:alpha:]", runs) );
+}
+
+TEST_CASE( "regex_literals only keeps portable escapes", "[single-file]" ) {
+    REQUIRE( _literals("\\<orc\\>") == vector<string>{"orc"} );
+    REQUIRE( _literals("an\\<orc\\> hits") == vector<string>{"orc", " hits"} );
+    REQUIRE( _literals("\\bfoo") == vector<string>{"foo"} );
+    REQUIRE( _literals("orc\\'s") == vector<string>{"orc"} );
+    REQUIRE( _literals("\\(\\$5\\)") == vector<string>{"($5)"} );
+
+    vector<string> runs;
+    REQUIRE( !regex_literals("\\x41bc", runs) );
+    REQUIRE( !regex_literals("\\Q.\\E", runs) );
+}
@@ -40,9 +40,70 @@
 #include "rltiles/tiledef-main.h"
 #include "unwind.h"
 
+cloud_store::cloud_store() : clouds(), slot(-1)
+{
+    clouds.reserve(GXM * GYM);
+}
+
+cloud_store &cloud_store::operator=(const cloud_store &other)
+{
+    // assign() reuses our storage, keeping the reservation made above.
+    clouds.assign(other.clouds.begin(), other.clouds.end());
+    slot = other.slot;
+    return *this;
+}
+
+cloud_struct *cloud_store::find(const coord_def &p)
+{
+    const short i = slot(p);
+    return i < 0 ? nullptr : &clouds[i];
+}
+
+const cloud_struct *cloud_store::find(const coord_def &p) const
+{
+    const short i = slot(p);
+    return i < 0 ? nullptr : &clouds[i];
+}
+
+cloud_struct &cloud_store::operator[](const coord_def &p)
+{
+    short &i = slot(p);
+    if (i < 0)
+    {
+        i = clouds.size();
+        clouds.emplace_back();
+        clouds.back().pos = p;
+    }
+    return clouds[i];
+}
+
+bool cloud_store::erase(const coord_def &p)
+{
+    const short i = slot(p);
+    if (i < 0)
+        return false;
+
+    slot(p) = -1;
+    if (i != (short)clouds.size() - 1)
+    {
+        clouds[i] = clouds.back();
+        ASSERT(slot(clouds[i].pos) == (short)clouds.size() - 1);
+        slot(clouds[i].pos) = i;
+    }
+    clouds.pop_back();
+    return true;
+}
+
+void cloud_store::clear()
+{
+    for (const cloud_struct &cloud : clouds)
+        slot(cloud.pos) = -1;
+    clouds.clear();
+}
+
 cloud_struct* cloud_at(coord_def pos)
 {
-    return map_find(env.cloud, pos);
+    return env.cloud.find(pos);
 }
 
 /// damage = base + random2avg(random, random/15 + 1)
@@ -551,8 +612,12 @@ static int _cloud_dissipation_rate(const cloud_struct &cloud)
     return dissipate;
 }
 
-static void _dissipate_cloud(cloud_struct& cloud)
+static void _dissipate_cloud(const coord_def pos)
 {
+    // Spreading adds clouds to env.cloud, so work on a copy of this one and
+    // store it back afterwards.
+    cloud_struct cloud = *cloud_at(pos);
+
     // Apply calculated rate to the actual cloud.
     cloud.decay -= _cloud_dissipation_rate(cloud);
 
@@ -564,9 +629,11 @@ static void _dissipate_cloud(cloud_struct& cloud)
         cloud.decay       -= _spread_cloud(cloud);
     }
 
+    *cloud_at(pos) = cloud;
+
     // Check for total dissipation and handle accordingly.
     if (cloud.decay < 1 && !_handle_conjure_flame(cloud))
-        delete_cloud(cloud.pos);
+        delete_cloud(pos);
 }
 
 static void _handle_spectral_cloud(const cloud_struct& cloud)
@@ -609,14 +676,18 @@ static void _handle_spectral_cloud(const cloud_struct& cloud)
 void manage_clouds()
 {
     // We can't iterate over env.cloud directly because _dissipate_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<cloud_struct *> cloud_ptrs;
-    for (auto& entry : env.cloud)
-        cloud_ptrs.push_back(&entry.second);
+    // will remove this cloud and move another into its slot.
+    vector<coord_def> cloud_locs;
+    for (const cloud_struct &cloud : env.cloud)
+        cloud_locs.push_back(cloud.pos);
 
-    for (auto ptr : cloud_ptrs)
+    for (const coord_def pos : cloud_locs)
     {
-        cloud_struct& cloud = *ptr;
+        if (!cloud_at(pos))
+            continue;
+        // Handling the clouds before this one may have added more, so take
+        // a copy rather than a reference into env.cloud.
+        const cloud_struct cloud = *cloud_at(pos);
 
 #ifdef ASSERTS
         if (cell_is_solid(cloud.pos))
@@ -642,7 +713,7 @@ void manage_clouds()
 
         _cloud_interacts_with_terrain(cloud);
 
-        _dissipate_cloud(cloud);
+        _dissipate_cloud(pos);
     }
 
     update_cloud_knowledge();
@@ -698,8 +769,8 @@ void delete_all_clouds()
     // We can't iterate over env.cloud directly because delete_cloud
     // will remove this cloud and invalidate our iterator.
     vector<coord_def> cloud_locs;
-    for (auto& entry : env.cloud)
-        cloud_locs.push_back(entry.first);
+    for (const cloud_struct &cloud : env.cloud)
+        cloud_locs.push_back(cloud.pos);
 
     for (auto pos : cloud_locs)
         delete_cloud(pos);
@@ -715,9 +786,10 @@ void move_cloud(coord_def src, coord_def newpos)
 
     const cloud_type old = cloud_type_at(newpos);
 
-    env.cloud[newpos] = env.cloud[src];
+    cloud_struct cloud = *cloud_at(src);
+    cloud.pos = newpos;
     env.cloud.erase(src);
-    env.cloud[newpos].pos = newpos;
+    env.cloud[newpos] = cloud;
     _los_cloud_changed(src, CLOUD_NONE, env.cloud[newpos].type);
     _los_cloud_changed(newpos, env.cloud[newpos].type, old);
 }
@@ -737,9 +809,9 @@ void swap_clouds(coord_def p1, coord_def p2)
         return;
     }
 
-    cloud_struct temp = env.cloud[p1];
-    env.cloud[p1] = env.cloud[p2];
-    env.cloud[p2] = temp;
+    cloud_struct temp = *cloud_at(p1);
+    *cloud_at(p1) = *cloud_at(p2);
+    *cloud_at(p2) = temp;
     env.cloud[p1].pos = p1;
     env.cloud[p2].pos = p2;
     _los_cloud_changed(p1, env.cloud[p1].type, env.cloud[p2].type);
@@ -1831,9 +1903,9 @@ void remove_tornado_clouds(mid_t whose)
     // We can't iterate over env.cloud directly because delete_cloud
     // will remove this cloud and invalidate our iterator.
     vector<coord_def> tornados;
-    for (auto& entry : env.cloud)
-        if (entry.second.type == CLOUD_TORNADO && entry.second.source == whose)
-            tornados.push_back(entry.first);
+    for (const cloud_struct &cloud : env.cloud)
+        if (cloud.type == CLOUD_TORNADO && cloud.source == whose)
+            tornados.push_back(cloud.pos);
 
     for (auto pos : tornados)
         delete_cloud(pos);
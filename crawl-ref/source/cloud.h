@@ -5,6 +5,12 @@
 
 #pragma once
 
+#include <vector>
+
+#include "fixedarray.h"
+
+using std::vector;
+
 struct cloud_struct
 {
     coord_def     pos;
@@ -39,6 +45,51 @@ struct cloud_struct
     static killer_type   whose_to_killer(kill_category whose);
 };
 
+/**
+ * The clouds on the current level.
+ *
+ * Clouds are kept in a dense array, with a grid mapping each cell to the
+ * index of its cloud. Removing a cloud moves the last one into its slot, so
+ * iteration follows slot order rather than coordinate order; that order is
+ * still fully determined by the sequence of insertions and removals, and is
+ * preserved across save and load.
+ *
+ * A new store reserves room for a cloud on every cell, and assigning to one
+ * keeps that reservation, so pointers from cloud_at() survive the creation
+ * of new clouds. Removing a cloud can move another one, so don't hold on to
+ * them across deletions.
+ */
+class cloud_store
+{
+public:
+    typedef vector<cloud_struct>::iterator iterator;
+    typedef vector<cloud_struct>::const_iterator const_iterator;
+
+    cloud_store();
+    cloud_store(const cloud_store &other) = default;
+    cloud_store &operator=(const cloud_store &other);
+
+    /// The cloud at p, or nullptr if there is none.
+    cloud_struct *find(const coord_def &p);
+    const cloud_struct *find(const coord_def &p) const;
+    /// The cloud at p, adding an empty one there if necessary.
+    cloud_struct &operator[](const coord_def &p);
+    bool erase(const coord_def &p);
+    void clear();
+
+    size_t size() const { return clouds.size(); }
+    bool empty() const { return clouds.empty(); }
+
+    iterator begin() { return clouds.begin(); }
+    iterator end() { return clouds.end(); }
+    const_iterator begin() const { return clouds.begin(); }
+    const_iterator end() const { return clouds.end(); }
+
+private:
+    vector<cloud_struct> clouds;
+    FixedArray<short, GXM, GYM> slot; // index into clouds, or -1
+};
+
 enum cloud_tile_variation
 {
     CTVARY_NONE,     ///< fixed tile (or special case)
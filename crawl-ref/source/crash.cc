@@ -83,6 +83,7 @@ template <typename TO, typename FROM> TO nasty_cast(FROM f)
 #include "files.h"
 #include "initfile.h"
 #include "options.h"
+#include "package.h"
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
@@ -158,6 +159,13 @@ void crash_signal_handler(int sig_num)
     // solution is to abort the crash dump.
     alarm(120);
 
+    // Let a save commit that's in flight reach the disk before we go down.
+    // This is under the alarm, since the disk may be what's stuck; the old
+    // header stays valid until the new one is written, so giving up on it
+    // loses nothing.
+    if (you.save)
+        you.save->await_commit();
+
     // In case the crash dumper is unable to open a file and has to dump
     // to stderr.
 #ifndef USE_TILE_LOCAL
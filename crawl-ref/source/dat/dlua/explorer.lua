@@ -485,7 +485,9 @@ function explorer.catalog_place(i, lvl, cats_to_show, show_level_fun)
     local result = nil
     if (dgn.br_exists(string.match(lvl, "[^:]+"))) then
         debug.goto_place(lvl)
+        local start = crawl.millis()
         debug.generate_level()
+        explorer.note_gen_time(lvl, crawl.millis() - start)
         local old_quiet = explorer.quiet
         if show_level_fun ~= nil and not show_level_fun(i) then
             explorer.quiet = true
@@ -530,6 +532,36 @@ function explorer.catalog_dungeon(max_depth, cats_to_show, show_level_fun)
     return result
 end
 
+-- wall-clock time spent in the level builder, per branch, for the seed
+-- currently being catalogued. Only reported if explorer.show_times is set.
+explorer.show_times = false
+explorer.gen_times = { }
+explorer.gen_branches = { }
+
+function explorer.note_gen_time(lvl, ms)
+    local br = string.match(lvl, "[^:]+")
+    if explorer.gen_times[br] == nil then
+        explorer.gen_times[br] = { levels = 0, ms = 0 }
+        explorer.gen_branches[#explorer.gen_branches + 1] = br
+    end
+    explorer.gen_times[br].levels = explorer.gen_times[br].levels + 1
+    explorer.gen_times[br].ms = explorer.gen_times[br].ms + ms
+end
+
+function explorer.report_gen_times(seed)
+    local levels, ms = 0, 0
+    crawl.stderr("Level generation times for seed " .. seed .. ":")
+    for _, br in ipairs(explorer.gen_branches) do
+        local t = explorer.gen_times[br]
+        crawl.stderr(string.format("    %-8s %3d levels %8d ms", br,
+                                   t.levels, t.ms))
+        levels = levels + t.levels
+        ms = ms + t.ms
+    end
+    crawl.stderr(string.format("    %-8s %3d levels %8d ms (%.1f ms/level)",
+                               "total", levels, ms, ms / math.max(levels, 1)))
+end
+
 function explorer.catalog_seed(seed, depth, cats, show_level_fun, describe_cat)
     seed_used = debug.reset_rng(seed)
     if describe_cat then
@@ -538,7 +570,11 @@ function explorer.catalog_seed(seed, depth, cats, show_level_fun, describe_cat)
         out("Catalog for seed " .. seed ..
             " (" .. table.concat(cats, ", ") .. "):")
     end
-    return explorer.catalog_dungeon(depth, cats, show_level_fun)
+    explorer.gen_times = { }
+    explorer.gen_branches = { }
+    local result = explorer.catalog_dungeon(depth, cats, show_level_fun)
+    if explorer.show_times then explorer.report_gen_times(seed) end
+    return result
 end
 
 explorer.internal_categories = { "vaults_raw" }
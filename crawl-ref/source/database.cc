@@ -7,10 +7,12 @@
 
 #include "database.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unordered_map>
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
 #endif
@@ -20,6 +22,7 @@
 #include "files.h"
 #include "libutil.h"
 #include "options.h"
+#include "pattern.h"
 #include "random.h"
 #include "stringutil.h"
 #include "syscalls.h"
@@ -31,8 +34,10 @@ class TextDB
 {
 public:
     // db_name is the savedir-relative name of the db file,
-    // minus the "db" extension.
-    TextDB(const char* db_name, const char* dir, vector<string> files);
+    // minus the "db" extension. If index_bodies is set, a trigram index
+    // of the entry bodies is stored along with them, for regex searches.
+    TextDB(const char* db_name, const char* dir, vector<string> files,
+           bool index_bodies = false);
     TextDB(TextDB *parent);
     ~TextDB() { shutdown(true); delete translation; }
     void init();
@@ -52,6 +57,8 @@ public:
     const char* const _db_name;
     string _directory;
     vector<string> _input_files;
+    bool _index_bodies;
+    bool _has_index;
     DBM* _db;
     string timestamp;
     TextDB *_parent;
@@ -67,6 +74,13 @@ static void _store_text_db(const string &in, DBM *db);
 static string _query_database(TextDB &db, string key, bool canonicalise_key,
                               bool run_lua, bool untranslated = false);
 static void _add_entry(DBM *db, const string &k, string &v);
+static datum _database_fetch(DBM *database, const string &key);
+static void _store_body_index(DBM *db);
+
+// The keys of all indexed entries, separated by newlines; the posting list
+// of each trigram is stored under TRIGRAM_PREFIX followed by the trigram.
+#define TRIGRAM_KEYS "__trigram_keys__"
+#define TRIGRAM_PREFIX "__trigram__"
 
 static TextDB AllDBs[] =
 {
@@ -84,7 +98,7 @@ static TextDB AllDBs[] =
             "cards.txt",
             "commands.txt",
             "clouds.txt",
-            "status.txt" }),
+            "status.txt" }, true),
 
     TextDB("gamestart", "descript/",
           { "species.txt",
@@ -160,8 +174,10 @@ static string _db_cache_path(string db, const char *lang)
 // TextDB
 // ----------------------------------------------------------------------
 
-TextDB::TextDB(const char* db_name, const char* dir, vector<string> files)
+TextDB::TextDB(const char* db_name, const char* dir, vector<string> files,
+               bool index_bodies)
     : _db_name(db_name), _directory(dir), _input_files(files),
+      _index_bodies(index_bodies), _has_index(false),
       _db(nullptr), timestamp(""), _parent(0), translation(0)
 {
 }
@@ -170,6 +186,7 @@ TextDB::TextDB(TextDB *parent)
     : _db_name(parent->_db_name),
       _directory(parent->_directory + Options.lang_name + "/"),
       _input_files(parent->_input_files), // FIXME: pointless copy
+      _index_bodies(parent->_index_bodies), _has_index(false),
       _db(nullptr), timestamp(""), _parent(parent), translation(nullptr)
 {
 }
@@ -188,6 +205,9 @@ bool TextDB::open_db()
     if (timestamp.empty())
         return false;
 
+    // SQLite gives back an empty string, not nothing, for missing keys.
+    _has_index = _database_fetch(_db, TRIGRAM_KEYS).dsize > 0;
+
     return true;
 }
 
@@ -255,7 +275,8 @@ bool TextDB::_needs_update() const
         return false;
     }
 
-    return ts != timestamp;
+    // Databases from before the index was added need rebuilding too.
+    return ts != timestamp || _db && _index_bodies && !_has_index;
 }
 
 void TextDB::_regenerate_db()
@@ -312,6 +333,8 @@ void TextDB::_regenerate_db()
             _store_text_db(full_input_path, _db);
         }
     }
+    if (_index_bodies)
+        _store_body_index(_db);
     _add_entry(_db, "TIMESTAMP", ts);
 
     dbm_close(_db);
@@ -356,6 +379,160 @@ static datum _database_fetch(DBM *database, const string &key)
     return result;
 }
 
+// Characters that go into the trigram index. Anything outside printable
+// ASCII is left out, since case-insensitive matching of it can't be
+// decided bytewise.
+static bool _indexable_char(char c)
+{
+    return c >= ' ' && c <= '~';
+}
+
+static string _datum_string(const datum &d)
+{
+    return d.dptr ? string((const char *)d.dptr, d.dsize) : string();
+}
+
+static vector<string> _index_keys(DBM *database)
+{
+    return split_string("\n", _datum_string(_database_fetch(database,
+                                                            TRIGRAM_KEYS)));
+}
+
+// Posting lists are stored as deltas between ascending entry numbers,
+// five bits per character, with 0x20 set on all but the last character of
+// each number. Everything stays printable, as not every DBM backend can
+// store arbitrary bytes.
+static void _append_posting(string &out, unsigned int n)
+{
+    for (; n >= 0x20; n >>= 5)
+        out += (char)('0' + (0x20 | (n & 0x1F)));
+    out += (char)('0' + n);
+}
+
+static vector<int> _read_postings(const string &in)
+{
+    vector<int> entries;
+    int last = -1;
+    unsigned int n = 0, shift = 0;
+    for (char c : in)
+    {
+        const unsigned int bits = c - '0';
+        n |= (bits & 0x1F) << shift;
+        shift += 5;
+        if (!(bits & 0x20))
+        {
+            last += n;
+            entries.push_back(last);
+            n = shift = 0;
+        }
+    }
+    return entries;
+}
+
+/**
+ * Use the trigram index to find the entries whose bodies might match regex.
+ *
+ * @param database        The database to search.
+ * @param regex           The pattern to look for.
+ * @param[out] candidates Every key whose body may match, in database order.
+ * @return false if the index can't help, either because the database has
+ *         none or because the pattern has no usable literals; the caller
+ *         must then check every entry.
+ */
+static bool _database_index_candidates(DBM *database, const string &regex,
+                                       vector<string> &candidates)
+{
+    vector<string> runs;
+    if (!regex_literals(regex, runs) || runs.empty())
+        return false;
+
+    const vector<string> keys = _index_keys(database);
+    if (keys.empty())
+        return false;
+
+    set<string> trigrams;
+    for (const string &run : runs)
+        for (size_t i = 0; i + 3 <= run.size(); ++i)
+            trigrams.insert(run.substr(i, 3));
+
+    vector<int> found;
+    bool first = true;
+    for (const string &tri : trigrams)
+    {
+        const vector<int> entries = _read_postings(
+            _datum_string(_database_fetch(database, TRIGRAM_PREFIX + tri)));
+        if (first)
+            found = entries;
+        else
+        {
+            vector<int> both;
+            set_intersection(found.begin(), found.end(),
+                             entries.begin(), entries.end(),
+                             back_inserter(both));
+            found.swap(both);
+        }
+        first = false;
+        if (found.empty())
+            break;
+    }
+
+    for (int entry : found)
+        if (entry < (int) keys.size())
+            candidates.push_back(keys[entry]);
+    return true;
+}
+
+// Build the index used by _database_index_candidates(). This has to see
+// every entry, so it is run once the text files have all been stored.
+static void _store_body_index(DBM *db)
+{
+    vector<string> keys;
+    unordered_map<string, vector<int>> postings;
+
+    for (datum dbKey = dbm_firstkey(db); dbKey.dptr != nullptr;
+         dbKey = dbm_nextkey(db))
+    {
+        const string key = _datum_string(dbKey);
+        if (key.find("__") != string::npos)
+            continue;
+
+        const int entry = keys.size();
+        keys.push_back(key);
+
+        const string body = _datum_string(dbm_fetch(db, dbKey));
+        set<string> trigrams;
+        string run;
+        for (char c : body)
+        {
+            if (!_indexable_char(c))
+            {
+                run.clear();
+                continue;
+            }
+            run += tolower(c);
+            if (run.size() >= 3)
+                trigrams.insert(run.substr(run.size() - 3));
+        }
+        for (const string &tri : trigrams)
+            postings[tri].push_back(entry);
+    }
+
+    for (auto &posting : postings)
+    {
+        string value;
+        int last = -1;
+        for (int entry : posting.second)
+        {
+            _append_posting(value, entry - last);
+            last = entry;
+        }
+        _add_entry(db, TRIGRAM_PREFIX + posting.first, value);
+    }
+
+    string value = comma_separated_line(keys.begin(), keys.end(), "\n", "\n");
+    _add_entry(db, TRIGRAM_KEYS, value);
+}
+
 static vector<string> _database_find_keys(DBM *database,
                                           const string &regex,
                                           bool ignore_case,
@@ -364,6 +541,17 @@ static vector<string> _database_find_keys(DBM *database,
     text_pattern             tpat(regex, ignore_case);
     vector<string> matches;
 
+    // Indexed databases have the list of keys in a single entry, which is
+    // much quicker to read than walking the whole database.
+    const vector<string> keys = _index_keys(database);
+    if (!keys.empty())
+    {
+        for (const string &key : keys)
+            if (tpat.matches(key) && (filter == nullptr || !(*filter)(key, "")))
+                matches.push_back(key);
+        return matches;
+    }
+
     datum dbKey = dbm_firstkey(database);
 
     while (dbKey.dptr != nullptr)
@@ -391,6 +579,22 @@ static vector<string> _database_find_bodies(DBM *database,
     text_pattern             tpat(regex, ignore_case);
     vector<string> matches;
 
+    // Only entries containing every literal in the regex need checking.
+    vector<string> candidates;
+    if (_database_index_candidates(database, regex, candidates))
+    {
+        for (const string &key : candidates)
+        {
+            const string body = _datum_string(_database_fetch(database, key));
+            if (tpat.matches(body)
+                && (filter == nullptr || !(*filter)(key, body)))
+            {
+                matches.push_back(key);
+            }
+        }
+        return matches;
+    }
+
     datum dbKey = dbm_firstkey(database);
 
     while (dbKey.dptr != nullptr)
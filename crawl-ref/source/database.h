@@ -19,6 +19,8 @@ extern "C" {
 #   define DB_DBM_HSEARCH 1
 #   include <db.h>
 }
+#elif defined(USE_MMAP_DBM)
+#   include "mmapdbm.h"
 #elif defined(USE_SQLITE_DBM)
 #   include "sqldbm.h"
 #else
@@ -27,6 +27,7 @@
 #include "macro.h"
 #include "message.h"
 #include "misc.h"
+#include "package.h"
 #include "prompt.h"
 #include "religion.h"
 #include "startup.h"
@@ -169,6 +170,10 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 {
     disable_other_crashes();
 
+    // Don't lose a save commit that's still on its way to the disk.
+    if (you.save)
+        you.save->await_commit();
+
     // Let "error" go out of scope for valgrind's sake.
     {
         string error = print_error ? strerror(errno) : "";
@@ -175,14 +175,16 @@ bool travel_exclude::in_bounds(const coord_def &p) const
 
 /////////////////////////////////////////////////////////////////////////
 
-exclude_set::exclude_set()
+exclude_set::exclude_set() : points_generation(0)
 {
+    exclude_counts.init(0);
 }
 
 void exclude_set::clear()
 {
     exclude_roots.clear();
-    exclude_points.clear();
+    exclude_counts.init(0);
+    ++points_generation;
 }
 
 void exclude_set::erase(const coord_def &p)
@@ -192,16 +194,19 @@ void exclude_set::erase(const coord_def &p)
     if (it == exclude_roots.end())
         return;
 
-    travel_exclude old_ex = it->second;
+    remove_exclude_points(it->second);
     exclude_roots.erase(it);
-
-    recompute_excluded_points();
+    ++points_generation;
 }
 
 void exclude_set::add_exclude(travel_exclude &ex)
 {
+    if (travel_exclude *old = get_exclude_root(ex.pos))
+        remove_exclude_points(*old);
+    ex.points.clear();
     add_exclude_points(ex);
     exclude_roots[ex.pos] = ex;
+    ++points_generation;
 }
 
 void exclude_set::add_exclude(const coord_def &p, int radius,
@@ -212,52 +217,77 @@ void exclude_set::add_exclude(const coord_def &p, int radius,
     add_exclude(ex);
 }
 
+// Count the cells ex covers. The cells are remembered with it, so that they
+// can be uncounted later even if its radius or LOS has changed meanwhile.
 void exclude_set::add_exclude_points(travel_exclude& ex)
 {
+    ASSERT(ex.points.empty());
+
     if (ex.radius == 0)
+        ex.points.push_back(ex.pos);
+    else
     {
-        exclude_points.insert(ex.pos);
-        return;
+        if (!ex.uptodate)
+            ex.set_los();
+        else
+            ex.los.update();
+
+        for (radius_iterator ri(ex.pos, ex.radius, C_SQUARE); ri; ++ri)
+            if (ex.affects(*ri))
+                ex.points.push_back(*ri);
     }
 
-    if (!ex.uptodate)
-        ex.set_los();
-    else
-        ex.los.update();
+    for (const coord_def &p : ex.points)
+        ++exclude_counts(p);
+}
 
-    for (radius_iterator ri(ex.pos, ex.radius, C_SQUARE); ri; ++ri)
-        if (ex.affects(*ri))
-            exclude_points.insert(*ri);
+void exclude_set::remove_exclude_points(travel_exclude& ex)
+{
+    for (const coord_def &p : ex.points)
+    {
+        ASSERT(exclude_counts(p) > 0);
+        --exclude_counts(p);
+    }
+    ex.points.clear();
 }
 
+// Recount only the exclusions that are out of date; the others' cells
+// haven't changed.
 void exclude_set::update_excluded_points(bool recompute_los)
 {
     for (iterator it = exclude_roots.begin(); it != exclude_roots.end(); ++it)
     {
         travel_exclude &ex = it->second;
-        if (!ex.uptodate)
-        {
-            recompute_excluded_points(recompute_los);
-            return;
-        }
+        if (ex.uptodate)
+            continue;
+
+        const vector<coord_def> old_points = ex.points;
+        remove_exclude_points(ex);
+        if (recompute_los)
+            ex.set_los();
+        add_exclude_points(ex);
+        if (ex.points != old_points)
+            ++points_generation;
     }
 }
 
 void exclude_set::recompute_excluded_points(bool recompute_los)
 {
-    exclude_points.clear();
+    exclude_counts.init(0);
     for (iterator it = exclude_roots.begin(); it != exclude_roots.end(); ++it)
     {
         travel_exclude &ex = it->second;
+        ex.points.clear();
         if (recompute_los)
             ex.set_los();
         add_exclude_points(ex);
     }
+    ++points_generation;
 }
 
 bool exclude_set::is_excluded(const coord_def &p) const
 {
-    return exclude_points.count(p);
+    return map_bounds(p) && exclude_counts(p) > 0;
 }
 
 bool exclude_set::is_exclude_root(const coord_def &p) const
@@ -270,6 +300,11 @@ travel_exclude* exclude_set::get_exclude_root(const coord_def &p)
     return map_find(exclude_roots, p);
 }
 
+unsigned int exclude_set::generation() const
+{
+    return points_generation;
+}
+
 size_t exclude_set::size() const
 {
     return exclude_roots.size();
@@ -487,7 +522,7 @@ void set_exclude(const coord_def &p, int radius, bool autoexcl, bool vaultexcl,
 
         exc->radius   = radius;
         exc->uptodate = false;
-        curr_excludes.recompute_excluded_points();
+        curr_excludes.update_excluded_points();
     }
     else
     {
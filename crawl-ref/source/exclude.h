@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "fixedarray.h"
 #include "los-def.h"
 
 using std::vector;
@@ -33,6 +34,7 @@ public:
     bool          autoex;       // Was set automatically.
     string        desc;         // Exclusion description.
     bool          vault;        // Is this exclusion set by a vault?
+    vector<coord_def> points;   // Cells counted for this in exclude_set.
 
     travel_exclude(const coord_def &p, int r = LOS_RADIUS,
                    bool autoex = false, string desc = "",
@@ -80,6 +82,9 @@ public:
     size_t size()  const;
     bool   empty() const;
 
+    // Changes whenever the set of excluded cells does.
+    unsigned int generation() const;
+
     const_iterator begin() const;
     const_iterator end() const;
 
@@ -87,13 +92,15 @@ public:
     iterator  end();
 
 private:
-    typedef set<coord_def> exclset;
-
     exclmap exclude_roots;
-    exclset exclude_points;
+    // How many exclusions cover each cell.
+    FixedArray<unsigned short, GXM, GYM> exclude_counts;
+
+    unsigned int points_generation;
 
 private:
     void add_exclude_points(travel_exclude& ex);
+    void remove_exclude_points(travel_exclude& ex);
 };
 
 extern exclude_set curr_excludes; // in travel.cc
@@ -25,6 +25,7 @@
 #include <cstring>
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <fcntl.h>
 #include <sys/stat.h>
 #ifdef HAVE_UTIMES
@@ -132,6 +133,9 @@ static bool _ghost_version_compatible(const save_version &version);
 
 static bool _restore_tagged_chunk(package *save, const string &name,
                                   tag_type tag, const char* complaint);
+static bool _restore_tagged_reader(reader &inf, const string &name,
+                                   tag_type tag, const char* complaint);
+static bool _restore_level_chunk(const string &name, const char* complaint);
 static bool _read_char_chunk(package *save);
 
 static bool _convert_obsolete_species();
@@ -1673,8 +1677,7 @@ bool generate_level(const level_id &l)
         // the level generated before the portals.
         ASSERT(you.save->has_chunk(save_name));
         dprf("Reloading new level '%s'.", save_name.c_str());
-        _restore_tagged_chunk(you.save, save_name, TAG_LEVEL,
-            "Level file is invalid.");
+        _restore_level_chunk(save_name, "Level file is invalid.");
     }
     // Did the generation process actually manage to place the player? This is
     // a useful sanity check, and also is necessary for the initial loading
@@ -2031,7 +2034,7 @@ bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
         }
 
         dprf("Loading old level '%s'.", level_name.c_str());
-        _restore_tagged_chunk(you.save, level_name, TAG_LEVEL, "Level file is invalid.");
+        _restore_level_chunk(level_name, "Level file is invalid.");
         if (load_mode != LOAD_VISITOR)
             you.on_current_level = true;
         _redraw_all(); // TODO why is there a redraw call here?
@@ -2289,6 +2292,239 @@ bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
     return just_created_level;
 }
 
+// Level deltas
+//
+// With Options.save_level_deltas, a level that is already in the save is
+// stored as the chunk written last time in full (the base) plus a delta
+// chunk describing how to turn the base into the current level, so leaving
+// a level doesn't rewrite all of it. The delta is recomputed against the
+// base on every save; once it is no longer much smaller than the base, the
+// base is rewritten in full and the delta dropped.
+//
+// A delta is a header (base length and hash, level length) followed by
+// copy (offset and length into the base) and literal (raw bytes) records,
+// found by matching blocks of the base against the new level.
+
+#define LEVEL_DELTA_SUFFIX ".delta"
+// Rewrite the base once the delta is bigger than this fraction of it.
+#define LEVEL_DELTA_MAX_RATIO 4
+#define LEVEL_DELTA_BLOCK 32
+
+enum level_delta_op
+{
+    LDELTA_END,
+    LDELTA_COPY,
+    LDELTA_LITERAL,
+};
+
+typedef vector<unsigned char> byte_vector;
+
+static uint32_t _level_delta_hash(const byte_vector &data)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    for (unsigned char c : data)
+        hash = (hash ^ c) * 16777619U;
+    return hash;
+}
+
+// A polynomial hash of a block, which can be rolled along a byte at a time.
+#define LEVEL_DELTA_MULT 257U
+
+static uint32_t _block_hash(const unsigned char *data)
+{
+    uint32_t hash = 0;
+    for (int i = 0; i < LEVEL_DELTA_BLOCK; ++i)
+        hash = hash * LEVEL_DELTA_MULT + data[i];
+    return hash;
+}
+
+static void _write_delta_literal(writer &outf, const byte_vector &data,
+                                 size_t start, size_t end)
+{
+    if (start == end)
+        return;
+    marshallByte(outf, LDELTA_LITERAL);
+    marshallInt(outf, end - start);
+    outf.write(&data[start], end - start);
+}
+
+static byte_vector _level_delta(const byte_vector &base,
+                                const byte_vector &level)
+{
+    byte_vector delta;
+    writer outf(&delta);
+    marshallInt(outf, base.size());
+    marshallInt(outf, _level_delta_hash(base));
+    marshallInt(outf, level.size());
+
+    // The first offset of each aligned block of the base, by hash.
+    unordered_map<uint32_t, size_t> blocks;
+    for (size_t i = 0; i + LEVEL_DELTA_BLOCK <= base.size();
+         i += LEVEL_DELTA_BLOCK)
+    {
+        blocks.emplace(_block_hash(&base[i]), i);
+    }
+
+    uint32_t top_mult = 1; // LEVEL_DELTA_MULT ^ (LEVEL_DELTA_BLOCK - 1)
+    for (int i = 1; i < LEVEL_DELTA_BLOCK; ++i)
+        top_mult *= LEVEL_DELTA_MULT;
+
+    size_t literal = 0; // start of the bytes not yet written
+    size_t pos = 0;
+    bool hashed = false;
+    uint32_t hash = 0;
+    while (pos + LEVEL_DELTA_BLOCK <= level.size())
+    {
+        if (!hashed)
+        {
+            hash = _block_hash(&level[pos]);
+            hashed = true;
+        }
+
+        auto block = blocks.find(hash);
+        if (block != blocks.end()
+            && !memcmp(&base[block->second], &level[pos], LEVEL_DELTA_BLOCK))
+        {
+            size_t from = block->second;
+            size_t len = LEVEL_DELTA_BLOCK;
+            while (from > 0 && pos > literal && base[from - 1] == level[pos - 1])
+            {
+                --from;
+                --pos;
+                ++len;
+            }
+            while (from + len < base.size() && pos + len < level.size()
+                   && base[from + len] == level[pos + len])
+            {
+                ++len;
+            }
+
+            _write_delta_literal(outf, level, literal, pos);
+            marshallByte(outf, LDELTA_COPY);
+            marshallInt(outf, from);
+            marshallInt(outf, len);
+            pos += len;
+            literal = pos;
+            hashed = false;
+            continue;
+        }
+
+        if (pos + LEVEL_DELTA_BLOCK < level.size())
+        {
+            hash = (hash - level[pos] * top_mult) * LEVEL_DELTA_MULT
+                   + level[pos + LEVEL_DELTA_BLOCK];
+        }
+        ++pos;
+    }
+    _write_delta_literal(outf, level, literal, level.size());
+    marshallByte(outf, LDELTA_END);
+    return delta;
+}
+
+static byte_vector _apply_level_delta(const string &name,
+                                      const byte_vector &base,
+                                      const byte_vector &delta)
+{
+    reader inf(delta);
+    if ((size_t)unmarshallInt(inf) != base.size()
+        || (uint32_t)unmarshallInt(inf) != _level_delta_hash(base))
+    {
+        fail("Level delta for \"%s\" doesn't match its base.", name.c_str());
+    }
+
+    const size_t level_size = unmarshallInt(inf);
+    byte_vector level;
+    level.reserve(level_size);
+    while (true)
+    {
+        const auto op = static_cast<level_delta_op>(unmarshallByte(inf));
+        if (op == LDELTA_END)
+            break;
+
+        if (op == LDELTA_COPY)
+        {
+            const size_t from = unmarshallInt(inf);
+            const size_t len = unmarshallInt(inf);
+            if (from > base.size() || len > base.size() - from)
+                fail("Bad copy in level delta for \"%s\".", name.c_str());
+            level.insert(level.end(), base.begin() + from,
+                         base.begin() + from + len);
+        }
+        else if (op == LDELTA_LITERAL)
+        {
+            const size_t len = unmarshallInt(inf);
+            const size_t at = level.size();
+            level.resize(at + len);
+            inf.read(&level[at], len);
+        }
+        else
+            fail("Bad record in level delta for \"%s\".", name.c_str());
+    }
+    inf.fail_if_not_eof(name + LEVEL_DELTA_SUFFIX);
+    if (level.size() != level_size)
+        fail("Level delta for \"%s\" has the wrong size.", name.c_str());
+    return level;
+}
+
+static byte_vector _read_raw_chunk(const string &name)
+{
+    vector<char> data;
+    chunk_reader inc(you.save, name);
+    inc.read_all(data);
+    return byte_vector(data.begin(), data.end());
+}
+
+static void _write_raw_chunk(const string &name, const byte_vector &data)
+{
+    writer outf(you.save, name);
+    outf.write(data.data(), data.size());
+}
+
+static void _write_level_chunk(const string &name)
+{
+    const string delta_name = name + LEVEL_DELTA_SUFFIX;
+
+    if (!Options.save_level_deltas || !you.save->has_chunk(name))
+    {
+        _write_tagged_chunk(name, TAG_LEVEL);
+        if (you.save->has_chunk(delta_name))
+            you.save->delete_chunk(delta_name);
+        return;
+    }
+
+    byte_vector level;
+    {
+        writer outf(&level);
+        write_save_version(outf, save_version::current());
+        tag_write(TAG_LEVEL, outf);
+    }
+
+    const byte_vector base = _read_raw_chunk(name);
+    const byte_vector delta = _level_delta(base, level);
+    if (delta.size() * LEVEL_DELTA_MAX_RATIO <= base.size())
+        _write_raw_chunk(delta_name, delta);
+    else
+    {
+        _write_raw_chunk(name, level);
+        if (you.save->has_chunk(delta_name))
+            you.save->delete_chunk(delta_name);
+    }
+}
+
+static bool _restore_level_chunk(const string &name, const char* complaint)
+{
+    const string delta_name = name + LEVEL_DELTA_SUFFIX;
+    if (!you.save->has_chunk(delta_name))
+        return _restore_tagged_chunk(you.save, name, TAG_LEVEL, complaint);
+
+    const byte_vector level =
+        _apply_level_delta(name, _read_raw_chunk(name),
+                           _read_raw_chunk(delta_name));
+    reader inf(level);
+    return _restore_tagged_reader(inf, name, TAG_LEVEL, complaint);
+}
+
 static void _save_level(const level_id& lid)
 {
     if (you.level_visited(lid))
@@ -2297,7 +2533,7 @@ static void _save_level(const level_id& lid)
     // Nail all items to the ground.
     fix_item_coordinates();
 
-    _write_tagged_chunk(lid.describe(), TAG_LEVEL);
+    _write_level_chunk(lid.describe());
 }
 
 #if TAG_MAJOR_VERSION == 34
@@ -3120,7 +3356,12 @@ void delete_level(const level_id &level)
     clear_level_annotations(level);
 
     if (you.save)
+    {
         you.save->delete_chunk(level.describe());
+        const string delta_name = level.describe() + LEVEL_DELTA_SUFFIX;
+        if (you.save->has_chunk(delta_name))
+            you.save->delete_chunk(delta_name);
+    }
 
     auto &visited = you.props[VISITED_LEVELS_KEY].get_table();
     visited.erase(level.describe());
@@ -3370,10 +3611,9 @@ static bool _tagged_chunk_version_compatible(reader &inf, string* reason)
     return true;
 }
 
-static bool _restore_tagged_chunk(package *save, const string &name,
-                                  tag_type tag, const char* complaint)
+static bool _restore_tagged_reader(reader &inf, const string &name,
+                                   tag_type tag, const char* complaint)
 {
-    reader inf(save, name);
     string reason;
     if (!_tagged_chunk_version_compatible(inf, &reason))
     {
@@ -3400,6 +3640,13 @@ static bool _restore_tagged_chunk(package *save, const string &name,
     return true;
 }
 
+static bool _restore_tagged_chunk(package *save, const string &name,
+                                  tag_type tag, const char* complaint)
+{
+    reader inf(save, name);
+    return _restore_tagged_reader(inf, name, tag, complaint);
+}
+
 static bool _ghost_version_compatible(const save_version &version)
 {
     if (!version.valid())
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Cache of free slots in a fixed pool such as env.item or env.mons.
+**/
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+/**
+ * A stack of the slots that were free when it was last filled, lowest on top.
+ *
+ * Slots can be filled by other means and emptied without telling the cache,
+ * so each slot is checked before it is handed out, and the stack is refilled
+ * from a full scan once it runs dry. Freed slots thus only come back after
+ * the current batch is used up, which keeps the cost of finding a slot
+ * constant on average instead of a scan of the whole pool each time.
+ */
+template <int SIZE>
+class free_slot_cache
+{
+public:
+    /**
+     * Take a free slot below limit.
+     *
+     * @param limit    Only slots below this are considered.
+     * @param is_free  Predicate telling whether a slot is currently free.
+     * @return a free slot, or -1 if the cache has none below limit. A scan
+     *         for the lowest free slot may still find one the cache doesn't
+     *         know about yet.
+     */
+    template <typename F>
+    int take(int limit, F is_free)
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            while (!slots.empty())
+            {
+                const int slot = slots.back();
+                // Everything further down the stack is higher still.
+                if (slot >= limit)
+                    return -1;
+                slots.pop_back();
+                if (is_free(slot))
+                    return slot;
+            }
+
+            if (pass == 0)
+                for (int i = SIZE - 1; i >= 0; --i)
+                    if (is_free(i))
+                        slots.push_back(i);
+        }
+        return -1;
+    }
+
+    void clear()
+    {
+        slots.clear();
+    }
+
+private:
+    vector<short> slots;
+};
@@ -150,6 +150,7 @@ const vector<GameOption*> game_options::build_options_list()
         new BoolGameOption(SIMPLE_NAME(easy_door), true),
         new BoolGameOption(SIMPLE_NAME(default_show_all_skills), false),
         new BoolGameOption(SIMPLE_NAME(read_persist_options), false),
+        new BoolGameOption(SIMPLE_NAME(save_level_deltas), false),
         new BoolGameOption(SIMPLE_NAME(auto_switch), false),
         new BoolGameOption(SIMPLE_NAME(suppress_startup_errors), false),
         new BoolGameOption(SIMPLE_NAME(simple_targeting), false),
@@ -1229,6 +1230,7 @@ void game_options::reset_options()
     sound_mappings.clear();
     menu_colour_mappings.clear();
     message_colour_mappings.clear();
+    message_filters_changed();
     named_options.clear();
 
     clear_cset_overrides();
@@ -2368,6 +2370,14 @@ void game_options::add_message_colour_mappings(const string &field,
         add_message_colour_mapping(fragment, prepend, subtract);
 }
 
+void game_options::message_filters_changed()
+{
+    // Global rather than per-object, so that no two versions of the lists
+    // ever share a generation.
+    static unsigned int generations = 0;
+    message_filter_generation = ++generations;
+}
+
 message_filter game_options::parse_message_filter(const string &filter)
 {
     string::size_type pos = filter.find(":");
@@ -3303,6 +3313,7 @@ void game_options::read_option_line(const string &str, bool runscript)
                 new_entries.push_back(mf);
         }
         merge_lists(filters, new_entries, caret_equal);
+        message_filters_changed();
     }
     else if (key == "travel_avoid_terrain")
     {
@@ -3400,6 +3411,7 @@ void game_options::read_option_line(const string &str, bool runscript)
             message_colour_mappings.clear();
 
         add_message_colour_mappings(field, caret_equal, minus_equal);
+        message_filters_changed();
     }
     else if (key == "dump_order")
     {
@@ -37,6 +37,7 @@
 #include "dungeon.h"
 #include "english.h"
 #include "env.h"
+#include "free-slots.h"
 #include "god-passive.h"
 #include "god-prayer.h"
 #include "hints.h"
@@ -493,9 +494,14 @@ void init_item(int item)
     env.item[item].clear();
 }
 
+static free_slot_cache<MAX_ITEMS> free_item_slots;
+
 // Returns an unused env.item slot, or NON_ITEM if none available.
 // The reserve is the number of item slots to not check.
 // Items may be culled if a reserve <= 10 is specified.
+// While a level is being generated, this is always the lowest unused slot,
+// so that the same seed keeps producing the same level; otherwise the slot
+// comes from a cache, without scanning env.item each time.
 int get_mitm_slot(int reserve)
 {
     ASSERT(reserve >= 0);
@@ -505,6 +511,17 @@ int get_mitm_slot(int reserve)
 
     int item = NON_ITEM;
 
+    if (!crawl_state.generating_level)
+    {
+        item = free_item_slots.take(MAX_ITEMS - reserve, [](int i)
+                                    { return !env.item[i].defined(); });
+        if (item >= 0)
+        {
+            init_item(item);
+            return item;
+        }
+    }
+
     for (item = 0; item < (MAX_ITEMS - reserve); item++)
         if (!env.item[item].defined())
             break;
@@ -371,6 +371,7 @@ void check_item_knowledge(bool unknown_items)
 
     menu.set_preselect(&selected_items);
     menu.set_flags( MF_QUIET_SELECT | MF_ALLOW_FORMATTING | MF_USE_TWO_COLUMNS
+                    | MF_VIRTUALIZE
                     | ((unknown_items) ? MF_NOSELECT
                                        : MF_MULTISELECT | MF_ALLOW_FILTER));
     menu.set_type(menu_type::know);
@@ -748,6 +748,31 @@ static int crawl_messages(lua_State *ls)
     return 1;
 }
 
+/*** How often each message filter option has matched this session.
+ * Covers force_more_message, flash_screen_message and message_colour, in
+ * the order they are checked, to help find filters that never fire.
+ *
+ * @treturn {{option=string,pattern=string,hits=int},...}
+ * @function message_filter_stats
+ */
+static int crawl_message_filter_stats(lua_State *ls)
+{
+    const vector<message_filter_stat> stats = message_filter_stats();
+    lua_newtable(ls);
+    for (int i = 0, count = stats.size(); i < count; ++i)
+    {
+        lua_newtable(ls);
+        lua_pushstring(ls, stats[i].option.c_str());
+        lua_setfield(ls, -2, "option");
+        lua_pushstring(ls, stats[i].pattern.c_str());
+        lua_setfield(ls, -2, "pattern");
+        lua_pushnumber(ls, stats[i].hits);
+        lua_setfield(ls, -2, "hits");
+        lua_rawseti(ls, -2, i + 1);
+    }
+    return 1;
+}
+
 #define REGEX_METATABLE "crawl.regex"
 #define MESSF_METATABLE "crawl.messf"
 
@@ -1519,6 +1544,7 @@ static const struct luaL_reg crawl_clib[] =
     { "messages",           crawl_messages },
     { "regex",              crawl_regex },
     { "message_filter",     crawl_message_filter },
+    { "message_filter_stats", crawl_message_filter_stats },
     { "trim",               crawl_trim },
     { "split",              crawl_split },
     { "string_compare",     crawl_string_compare },
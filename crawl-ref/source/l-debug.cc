@@ -15,6 +15,7 @@
 #include "files.h"
 #include "god-wrath.h"
 #include "los.h"
+#include "losglobal.h"
 #include "maps.h"
 #include "message.h"
 #include "mon-act.h"
@@ -23,10 +24,12 @@
 #include "mon-poly.h"
 #include "ng-setup.h"
 #include "religion.h"
+#include "shopping.h"
 #include "stairs.h"
 #include "state.h"
 #include "stringutil.h"
 #include "tileview.h"
+#include "travel.h"
 #include "unwind.h"
 #include "view.h"
 #include "wiz-dgn.h"
@@ -122,6 +125,47 @@ LUAFN(debug_reveal_mimics)
 
 LUAWRAP(debug_los_changed, los_changed())
 
+// Usage: hits, misses, recomputes, invalidations, flushes = los_cache_stats()
+// Returns the cell_see_cell cache counters. If the optional argument is
+// true, the counters are reset afterwards.
+LUAFN(debug_los_cache_stats)
+{
+    const globallos_stats &stats = get_globallos_stats();
+    lua_pushnumber(ls, stats.hits);
+    lua_pushnumber(ls, stats.misses);
+    lua_pushnumber(ls, stats.recomputes);
+    lua_pushnumber(ls, stats.invalidations);
+    lua_pushnumber(ls, stats.flushes);
+    if (lua_toboolean(ls, 1))
+        reset_globallos_stats();
+    return 5;
+}
+
+// Usage: pathfinds, floods, answers, settled = travel_flood_stats(<reset>)
+// Returns travel pathfinding counters: pathfind calls, floods from scratch,
+// queries answered from distance fields, and squares those fields settled.
+// If the optional argument is true, the counters are reset afterwards.
+LUAFN(debug_travel_flood_stats)
+{
+    const travel_flood_stats &stats = get_travel_flood_stats();
+    lua_pushnumber(ls, stats.pathfinds);
+    lua_pushnumber(ls, stats.floods);
+    lua_pushnumber(ls, stats.field_answers);
+    lua_pushnumber(ls, stats.field_settled);
+    if (lua_toboolean(ls, 1))
+        reset_travel_flood_stats();
+    return 4;
+}
+
+// Usage: travel_distance_fields(<enabled>)
+// Turns distance fields for travel and explore on or off, so that plain
+// floods can be timed against them.
+LUAFN(debug_travel_distance_fields)
+{
+    set_travel_distance_fields(lua_toboolean(ls, 1));
+    return 0;
+}
+
 LUAFN(debug_builder_ignore_depth)
 {
     const bool b = lua_toboolean(ls, 1);
@@ -151,6 +195,9 @@ LUAFN(_debug_test_explore)
 {
     UNUSED(ls);
 #ifdef WIZARD
+    // Scripts run without a game, but travel and item pickup expect one.
+    unwind_bool need_save(crawl_state.need_save, true);
+    shopping_list.refresh();
     debug_test_explore();
 #endif
     return 0;
@@ -546,9 +593,12 @@ const struct luaL_reg debug_dlib[] =
 { "generate_level", debug_generate_level },
 { "reveal_mimics", debug_reveal_mimics },
 { "los_changed", debug_los_changed },
+{ "los_cache_stats", debug_los_cache_stats },
 { "dump_map", debug_dump_map },
 { "vault_names", debug_vault_names },
 { "test_explore", _debug_test_explore },
+{ "travel_flood_stats", debug_travel_flood_stats },
+{ "travel_distance_fields", debug_travel_distance_fields },
 { "bouncy_beam", debug_bouncy_beam },
 { "cull_monsters", debug_cull_monsters},
 { "dismiss_adjacent", debug_dismiss_adjacent},
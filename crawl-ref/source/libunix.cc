@@ -302,8 +302,14 @@ static short translate_colour(COLOURS col);
  */
 static void write_char_at(int y, int x, const cchar_t &ch);
 
+static inline cchar_t character_at(int y, int x);
+
 static bool cursor_is_enabled = true;
 
+// Whether anything may have changed on screen since the last refresh, so that
+// update_screen() can skip frames that would leave the terminal as it was.
+static bool screen_is_dirty = true;
+
 static unsigned int convert_to_curses_style(int chattr)
 {
     switch (chattr & CHATTR_ATTRMASK)
@@ -735,8 +741,12 @@ void console_startup()
 
     scrollok(stdscr, FALSE);
 
+    // A new screen starts with the cursor shown; keep it as it was before.
+    curs_set(cursor_is_enabled);
+
     // Must call refresh() for ncurses to update COLS and LINES.
     refresh();
+    screen_is_dirty = true;
     crawl_view.init_geometry();
 
     set_mouse_enabled(false);
@@ -793,6 +803,7 @@ void putwch(char32_t chr)
         c = ' ';
     // TODO: recognize unsupported characters and try to transliterate
     addnwstr(&c, 1);
+    screen_is_dirty = true;
 
 #ifdef USE_TILE_WEB
     char32_t buf[2];
@@ -802,17 +813,83 @@ void putwch(char32_t chr)
 #endif
 }
 
+// Would writing glyph with the current attributes leave the cell at y, x as
+// it is?
+static bool _cell_unchanged(int y, int x, char32_t glyph)
+{
+    if (!glyph)
+        glyph = ' ';
+    // Don't try to compare the halves of wide characters.
+    if (wcwidth(glyph) != 1)
+        return false;
+
+    attr_t attr = 0;
+    short pair = 0;
+    attr_get(&attr, &pair, nullptr);
+
+    const cchar_t old = character_at(y, x);
+    wchar_t old_wch[CCHARW_MAX + 1] = { 0 };
+    attr_t old_attr = 0;
+    short old_pair = 0;
+    if (getcchar(&old, nullptr, &old_attr, &old_pair, nullptr) > CCHARW_MAX + 1)
+        return false;
+    getcchar(&old, old_wch, &old_attr, &old_pair, nullptr);
+
+    return old_wch[0] == (wchar_t) glyph && !old_wch[1]
+           && (old_attr & ~A_COLOR) == (attr & ~A_COLOR)
+           && old_pair == pair;
+}
+
 void puttext(int x1, int y1, const crawl_view_buffer &vbuf)
 {
     const screen_cell_t *cell = vbuf;
     const coord_def size = vbuf.size();
+
+#ifdef USE_TILE_WEB
+    // The webtiles console mirrors what's written here, not what curses
+    // holds, so it needs every cell.
+    if (tiles.is_controlled_from_web())
+    {
+        for (int y = 0; y < size.y; ++y)
+        {
+            cgotoxy(x1, y1 + y);
+            for (int x = 0; x < size.x; ++x)
+            {
+                put_colour_ch(cell->colour, cell->glyph);
+                cell++;
+            }
+        }
+        return;
+    }
+#endif
+
+    // Only write the runs of cells that differ from what's already on the
+    // screen, so that an unchanged view leaves nothing for refresh() to do.
+    int colour = -1;
     for (int y = 0; y < size.y; ++y)
     {
         cgotoxy(x1, y1 + y);
-        for (int x = 0; x < size.x; ++x)
+        const int sy = getcury(stdscr), sx = getcurx(stdscr);
+        bool in_place = true;
+        for (int x = 0; x < size.x; ++x, ++cell)
         {
-            put_colour_ch(cell->colour, cell->glyph);
-            cell++;
+            if (cell->colour != colour)
+            {
+                colour = cell->colour;
+                textcolour(colour);
+            }
+
+            if (_cell_unchanged(sy, sx + x, cell->glyph))
+            {
+                in_place = false;
+                continue;
+            }
+            if (!in_place)
+            {
+                cgotoxy(x1 + x, y1 + y);
+                in_place = true;
+            }
+            putwch(cell->glyph);
         }
     }
 }
@@ -825,11 +902,12 @@ void puttext(int x1, int y1, const crawl_view_buffer &vbuf)
 void update_screen()
 {
     // In objstat and similar modes, there might not be a screen to update.
-    if (stdscr)
+    if (stdscr && screen_is_dirty)
     {
         // Refreshing the default colors helps keep colors synced in ttyrecs.
         curs_set_default_colors();
         refresh();
+        screen_is_dirty = false;
     }
 
 #ifdef USE_TILE_WEB
@@ -842,6 +920,7 @@ void clear_to_end_of_line()
     textcolour(LIGHTGREY);
     textbackground(BLACK);
     clrtoeol();
+    screen_is_dirty = true;
 
 #ifdef USE_TILE_WEB
     tiles.clear_to_end_of_line();
@@ -886,6 +965,7 @@ void clrscr_sys()
     textcolour(LIGHTGREY);
     textbackground(BLACK);
     clear();
+    screen_is_dirty = true;
 #ifdef DGAMELAUNCH
     if (!_suppress_dgl_clrscr)
     {
@@ -898,7 +978,13 @@ void clrscr_sys()
 
 void set_cursor_enabled(bool enabled)
 {
-    curs_set(cursor_is_enabled = enabled);
+    // curs_set() writes to the terminal straight away, so don't repeat it;
+    // cursor_control toggles this around every HUD redraw.
+    if (enabled != cursor_is_enabled)
+    {
+        curs_set(cursor_is_enabled = enabled);
+        screen_is_dirty = true;
+    }
 #ifdef USE_TILE_WEB
     tiles.set_text_cursor(enabled);
 #endif
@@ -1403,6 +1489,9 @@ void textbackground(int col)
 void gotoxy_sys(int x, int y)
 {
     move(y - 1, x - 1);
+    // A hidden cursor can be left wherever it was.
+    if (cursor_is_enabled)
+        screen_is_dirty = true;
 }
 
 static inline cchar_t character_at(int y, int x)
@@ -1443,6 +1532,7 @@ static void write_char_at(int y, int x, const cchar_t &ch)
 
     attr_set(attr, color_pair, nullptr);
     mvadd_wchnstr(y, x, &ch, 1);
+    screen_is_dirty = true;
 }
 
 // see declaration
@@ -46,6 +46,20 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+
+// losight() combines the blockrays of a quadrant one machine word at a time,
+// or LOS_SIMD_WORDS words at a time with SSE2 or AVX2. Build with NO_SIMD_LOS
+// to force the plain 64-bit version.
+#if !defined(NO_SIMD_LOS) && defined(__AVX2__)
+# include <immintrin.h>
+# define LOS_SIMD_WORDS 4
+#elif !defined(NO_SIMD_LOS) && (defined(__SSE2__) || defined(_M_X64))
+# include <emmintrin.h>
+# define LOS_SIMD_WORDS 2
+#else
+# define LOS_SIMD_WORDS 1
+#endif
 
 #include "areas.h"
 #include "coord.h"
@@ -85,11 +99,26 @@ static blockrays_t blockrays;
 struct cellray;
 static FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellrays;
 
+// For each cell p in the quadrant, the end cells of all minimal
+// cellrays that p blocks: the cells whose visibility from the
+// origin can depend on the opacity of p. Used by losglobal.cc to
+// invalidate cached visibility selectively.
+typedef FixedArray<vector<coord_def>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1>
+    blocked_ends_t;
+static blocked_ends_t blocked_ends;
+
+// The blockrays again, packed into 64-bit words for losight(): the
+// mask for quadrant cell p starts at ray_mask_words * _ray_mask_index(p).
+// Masks are padded with zeroes to a multiple of LOS_SIMD_WORDS words.
+typedef uint64_t ray_word;
+static int ray_mask_words = 0;
+static vector<ray_word> blockray_masks;
+
 // Temporary arrays used in losight() to track which rays
 // are blocked or have seen a smoke cloud.
 // Allocated when doing the precomputations.
-static bit_vector *dead_rays     = nullptr;
-static bit_vector *smoke_rays    = nullptr;
+static vector<ray_word> dead_rays;
+static vector<ray_word> smoke_rays;
 
 class quadrant_iterator : public rectangle_iterator
 {
@@ -103,12 +132,15 @@ public:
 
 void clear_rays_on_exit()
 {
-    delete dead_rays;
-    delete smoke_rays;
     for (quadrant_iterator qi; qi; ++qi)
         delete blockrays(*qi);
 }
 
+static inline int _ray_mask_index(const coord_def& p)
+{
+    return p.x * (LOS_MAX_RANGE + 1) + p.y;
+}
+
 // LOS radius.
 int los_radius = LOS_DEFAULT_RANGE;
 
@@ -429,8 +461,34 @@ static void _create_blockrays()
     for (quadrant_iterator qi; qi; ++qi)
         delete all_blockrays(*qi);
 
-    dead_rays  = new bit_vector(n_min_rays);
-    smoke_rays = new bit_vector(n_min_rays);
+    // Collect the distinct end cells of the rays each cell blocks.
+    for (quadrant_iterator qi; qi; ++qi)
+    {
+        vector<coord_def> &ends = blocked_ends(*qi);
+        for (int i = 0; i < n_min_rays; ++i)
+            if (blockrays(*qi)->get(i))
+                ends.push_back(cellray_ends[i]);
+        sort(ends.begin(), ends.end());
+        ends.erase(unique(ends.begin(), ends.end()), ends.end());
+    }
+
+    // Pack the blockrays into words for losight().
+    const int n_words = (n_min_rays + 63) / 64;
+    ray_mask_words = (n_words + LOS_SIMD_WORDS - 1)
+                     / LOS_SIMD_WORDS * LOS_SIMD_WORDS;
+    blockray_masks.assign(ray_mask_words * (LOS_MAX_RANGE + 1)
+                                         * (LOS_MAX_RANGE + 1), 0);
+    for (quadrant_iterator qi; qi; ++qi)
+    {
+        ray_word *mask =
+            &blockray_masks[ray_mask_words * _ray_mask_index(*qi)];
+        for (int i = 0; i < n_min_rays; ++i)
+            if (blockrays(*qi)->get(i))
+                mask[i / 64] |= (ray_word)1 << (i % 64);
+    }
+
+    dead_rays.assign(ray_mask_words, 0);
+    smoke_rays.assign(ray_mask_words, 0);
 
     dprf("Cellrays: %d Fullrays: %u Minimal cellrays: %u",
           n_cellrays, (unsigned int)fullrays.size(), n_min_rays);
@@ -590,6 +648,21 @@ static bool _find_ray_se(const coord_def& target, ray_def& ray,
     return true;
 }
 
+// Return the cells (relative to the origin, in the positive quadrant)
+// whose visibility from the origin might change if the opacity of p
+// changes. p must lie in the positive quadrant.
+const vector<coord_def>& los_blocked_cells(const coord_def& p)
+{
+    ASSERT(p.x >= 0);
+    ASSERT(p.y >= 0);
+    ASSERT(p.rdist() <= LOS_MAX_RANGE);
+
+    // Ensure the precalculations have been done.
+    raycast();
+
+    return blocked_ends(p);
+}
+
 // Coordinate transformation so we can find_ray quadrant-by-quadrant.
 struct opacity_trans : public opacity_func
 {
@@ -792,12 +865,70 @@ bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2)
 // Smoke will now only block LOS after two cells of smoke. This is
 // done by updating with a second array.
 
+// dead |= block
+static inline void _block_rays(ray_word *dead, const ray_word *block)
+{
+#if LOS_SIMD_WORDS == 4
+    for (int w = 0; w < ray_mask_words; w += 4)
+    {
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(block + w));
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dead + w));
+        _mm256_storeu_si256((__m256i*)(dead + w), _mm256_or_si256(d, b));
+    }
+#elif LOS_SIMD_WORDS == 2
+    for (int w = 0; w < ray_mask_words; w += 2)
+    {
+        const __m128i b = _mm_loadu_si128((const __m128i*)(block + w));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dead + w));
+        _mm_storeu_si128((__m128i*)(dead + w), _mm_or_si128(d, b));
+    }
+#else
+    for (int w = 0; w < ray_mask_words; ++w)
+        dead[w] |= block[w];
+#endif
+}
+
+// dead |= smoke & block; smoke |= block
+static inline void _smoke_rays(ray_word *dead, ray_word *smoke,
+                               const ray_word *block)
+{
+#if LOS_SIMD_WORDS == 4
+    for (int w = 0; w < ray_mask_words; w += 4)
+    {
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(block + w));
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(dead + w));
+        const __m256i s = _mm256_loadu_si256((const __m256i*)(smoke + w));
+        _mm256_storeu_si256((__m256i*)(dead + w),
+                            _mm256_or_si256(d, _mm256_and_si256(s, b)));
+        _mm256_storeu_si256((__m256i*)(smoke + w), _mm256_or_si256(s, b));
+    }
+#elif LOS_SIMD_WORDS == 2
+    for (int w = 0; w < ray_mask_words; w += 2)
+    {
+        const __m128i b = _mm_loadu_si128((const __m128i*)(block + w));
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dead + w));
+        const __m128i s = _mm_loadu_si128((const __m128i*)(smoke + w));
+        _mm_storeu_si128((__m128i*)(dead + w),
+                         _mm_or_si128(d, _mm_and_si128(s, b)));
+        _mm_storeu_si128((__m128i*)(smoke + w), _mm_or_si128(s, b));
+    }
+#else
+    for (int w = 0; w < ray_mask_words; ++w)
+    {
+        dead[w]  |= smoke[w] & block[w];
+        smoke[w] |= block[w];
+    }
+#endif
+}
+
 static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy)
 {
     const unsigned int num_cellrays = cellray_ends.size();
+    ray_word *dead = dead_rays.data();
+    ray_word *smoke = smoke_rays.data();
 
-    dead_rays->reset();
-    smoke_rays->reset();
+    fill(dead_rays.begin(), dead_rays.end(), 0);
+    fill(smoke_rays.begin(), smoke_rays.end(), 0);
 
     for (quadrant_iterator qi; qi; ++qi)
     {
@@ -805,16 +936,17 @@ static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy
         if (!dat.los_bounds(p))
             continue;
 
+        const ray_word *block =
+            &blockray_masks[ray_mask_words * _ray_mask_index(*qi)];
         switch (dat.opacity(p))
         {
         case OPC_OPAQUE:
             // Block the appropriate rays.
-            *dead_rays |= *blockrays(*qi);
+            _block_rays(dead, block);
             break;
         case OPC_HALF:
             // Block rays which have already seen a cloud.
-            *dead_rays  |= (*smoke_rays & *blockrays(*qi));
-            *smoke_rays |= *blockrays(*qi);
+            _smoke_rays(dead, smoke, block);
             break;
         default:
             break;
@@ -823,11 +955,15 @@ static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy
 
     // Ray calculation done. Now work out which cells in this
     // quadrant are visible.
-    for (unsigned int rayidx = 0; rayidx < num_cellrays; ++rayidx)
+    for (unsigned int base = 0; base < num_cellrays; base += 64)
     {
-        // make the cells seen by this ray at this point visible
-        if (!dead_rays->get(rayidx))
+        // make the cells seen by the rays alive at this point visible
+        ray_word alive = ~dead[base / 64];
+        for (unsigned int rayidx = base; alive && rayidx < num_cellrays;
+             ++rayidx, alive >>= 1)
         {
+            if (!(alive & 1))
+                continue;
             // This ray is alive, thus the end cell is visible.
             const coord_def p = coord_def(sx * cellray_ends[rayidx].x,
                                           sy * cellray_ends[rayidx].y);
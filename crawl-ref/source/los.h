@@ -38,6 +38,7 @@ int num_feats_between(const coord_def& source, const coord_def& target,
                       bool exclude_endpoints = true,
                       bool just_check = false);
 bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2);
+const vector<coord_def>& los_blocked_cells(const coord_def& p);
 
 typedef SquareArray<bool, LOS_MAX_RANGE> los_grid;
 
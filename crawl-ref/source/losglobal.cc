@@ -5,6 +5,7 @@
 #include "coord.h"
 #include "coordit.h"
 #include "libutil.h"
+#include "los.h"
 #include "los-def.h"
 
 #define LOS_KNOWN 4
@@ -17,6 +18,26 @@ typedef halflos_t globallos_t[GXM][GYM];
 
 static globallos_t globallos;
 
+// The epoch at which each halflos block was last cleared. A block whose
+// epoch lags behind globallos_epoch holds only stale data, and is cleared
+// on its next lookup; this way invalidate_los() doesn't have to touch the
+// whole cache.
+typedef uint32_t epoch_t;
+static epoch_t globallos_block_epoch[GXM][GYM];
+static epoch_t globallos_epoch = 1;
+
+static globallos_stats los_stats;
+
+static halflos_t& _globallos_block(int x, int y)
+{
+    if (globallos_block_epoch[x][y] != globallos_epoch)
+    {
+        memset(globallos[x][y], 0, sizeof(halflos_t));
+        globallos_block_epoch[x][y] = globallos_epoch;
+    }
+    return globallos[x][y];
+}
+
 static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
 {
     COMPILE_CHECK(LOS_KNOWN * 2 <= sizeof(losfield_t) * 8);
@@ -28,9 +49,15 @@ static losfield_t* _lookup_globallos(const coord_def& p, const coord_def& q)
         return nullptr;
     // p < q iff p.x < q.x || p.x == q.x && p.y < q.y
     if (diff < coord_def(0, 0))
-        return &globallos[q.x][q.y][-diff.x + o_half_x][-diff.y + o_half_y];
+    {
+        halflos_t &half = _globallos_block(q.x, q.y);
+        return &half[-diff.x + o_half_x][-diff.y + o_half_y];
+    }
     else
-        return &globallos[p.x][p.y][ diff.x + o_half_x][ diff.y + o_half_y];
+    {
+        halflos_t &half = _globallos_block(p.x, p.y);
+        return &half[ diff.x + o_half_x][ diff.y + o_half_y];
+    }
 }
 
 static void _save_los(los_def* los, los_type l)
@@ -59,25 +86,55 @@ static void _save_los(los_def* los, los_type l)
 }
 
 // Opacity at p has changed.
+// Only forget those cell pairs that have a minimal cellray passing
+// through p; everything else in the cache is unaffected.
 void invalidate_los_around(const coord_def& p)
 {
-    int x1 = max(p.x - LOS_MAX_RANGE, 0);
-    int y1 = max(p.y - LOS_MAX_RANGE, 0);
-    int x2 = min(p.x, GXM - 1);
-    int y2 = min(p.y + LOS_MAX_RANGE, GYM - 1);
-    for (int y = y1; y <= y2; y++)
-        for (int x = x1; x <= x2; x++)
-            memset(globallos[x][y], 0, sizeof(halflos_t));
+    for (int ox = p.x - LOS_MAX_RANGE; ox <= p.x + LOS_MAX_RANGE; ++ox)
+        for (int oy = p.y - LOS_MAX_RANGE; oy <= p.y + LOS_MAX_RANGE; ++oy)
+        {
+            const coord_def o(ox, oy);
+            if (!map_bounds(o))
+                continue;
+
+            const coord_def d = p - o;
+            const vector<coord_def> &ends = los_blocked_cells(
+                coord_def(abs(d.x), abs(d.y)));
+            if (ends.empty())
+                continue;
+
+            // Cells on an axis are part of both adjacent quadrants.
+            const int sx_lo = d.x > 0 ? 1 : -1, sx_hi = d.x < 0 ? -1 : 1;
+            const int sy_lo = d.y > 0 ? 1 : -1, sy_hi = d.y < 0 ? -1 : 1;
+            for (int sx = sx_lo; sx <= sx_hi; sx += 2)
+                for (int sy = sy_lo; sy <= sy_hi; sy += 2)
+                    for (const coord_def &e : ends)
+                    {
+                        const coord_def q(o.x + sx * e.x, o.y + sy * e.y);
+                        losfield_t* flags = _lookup_globallos(o, q);
+                        if (flags && *flags)
+                        {
+                            *flags = 0;
+                            los_stats.invalidations++;
+                        }
+                    }
+        }
 }
 
 void invalidate_los()
 {
-    for (rectangle_iterator ri(0); ri; ++ri)
-        memset(globallos[ri->x][ri->y], 0, sizeof(halflos_t));
+    los_stats.flushes++;
+    if (++globallos_epoch == 0)
+    {
+        // The epoch wrapped around; start from a clean slate.
+        memset(globallos_block_epoch, 0, sizeof(globallos_block_epoch));
+        globallos_epoch = 1;
+    }
 }
 
 static void _update_globallos_at(const coord_def& p, los_type l)
 {
+    los_stats.recomputes++;
     switch (l)
     {
     case LOS_DEFAULT:
@@ -123,9 +180,24 @@ bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
     if (!flags)
         return false; // outside range
 
-    if (!(*flags & (l << LOS_KNOWN)))
+    if (*flags & (l << LOS_KNOWN))
+        los_stats.hits++;
+    else
+    {
+        los_stats.misses++;
         _update_globallos_at(p, l);
+    }
 
     ASSERT(*flags & (l << LOS_KNOWN));
     return *flags & l;
 }
+
+const globallos_stats& get_globallos_stats()
+{
+    return los_stats;
+}
+
+void reset_globallos_stats()
+{
+    los_stats = globallos_stats();
+}
@@ -6,3 +6,16 @@ void invalidate_los_around(const coord_def& p);
 void invalidate_los();
 
 bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l);
+
+// Counters for judging the effectiveness of the cell_see_cell cache.
+struct globallos_stats
+{
+    uint64_t hits = 0;          // lookups answered from the cache
+    uint64_t misses = 0;        // lookups that had to recompute
+    uint64_t recomputes = 0;    // full LOS fields calculated
+    uint64_t invalidations = 0; // cached cell pairs dropped by terrain changes
+    uint64_t flushes = 0;       // whole-cache invalidations
+};
+
+const globallos_stats& get_globallos_stats();
+void reset_globallos_stats();
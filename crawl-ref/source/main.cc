@@ -2218,8 +2218,13 @@ static void _prep_input()
     you.redraw_status_lights = true;
     if (you.running == 0)
         you.quiver_action.set_needs_redraw();
-    print_stats();
-    update_screen();
+    // Resting with rest_delay -1 doesn't draw the map, so leave the HUD until
+    // the rest is over as well; the redraw flags keep track of what changed.
+    if (!you.running.is_rest() || Options.rest_delay != -1)
+    {
+        print_stats();
+        update_screen();
+    }
 
     viewwindow();
     update_screen(); // ???
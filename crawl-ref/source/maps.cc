@@ -10,8 +10,10 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <sys/param.h>
 #include <sys/types.h>
+#include <unordered_map>
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
 #endif
@@ -26,6 +28,7 @@
 #include "files.h"
 #include "mapmark.h"
 #include "message.h"
+#include "mmapdbm.h"
 #include "state.h"
 #include "stringutil.h"
 #include "syscalls.h"
@@ -50,6 +53,7 @@ static map_section_type _apply_vault_definition(
     bool check_place);
 
 static bool _resolve_map(map_def &def);
+static void _reset_map_selection_index();
 
 static bool _map_safe_vault_place(const map_def &map,
                                   const coord_def &c,
@@ -738,6 +742,126 @@ vector<string> find_map_matches(const string &name)
     return matches;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Vault selection indices
+//
+// Built on demand from vdefs, and discarded whenever vdefs changes. They
+// narrow down the maps a selector has to look at; the selector still checks
+// every candidate, so they change nothing about which maps are chosen. All
+// lists are in vdefs order, the same order a full scan would produce.
+
+typedef vector<unsigned> vault_indices;
+
+// Maps with each tag.
+static unordered_map<string, vault_indices> map_tag_index;
+static bool map_tag_index_built = false;
+
+// Per level, the maps that could be selected there by place, by depth, and
+// by depth and chance, looking only at properties of the map itself.
+struct level_map_indices
+{
+    int branch_depth; // brdepth[] of the level's branch when this was built
+    vault_indices by_place;
+    vault_indices by_depth;
+    vault_indices by_chance;
+};
+static map<level_id, level_map_indices> map_depth_index;
+
+static void _reset_map_selection_index()
+{
+    map_tag_index.clear();
+    map_tag_index_built = false;
+    map_depth_index.clear();
+}
+
+static const unordered_map<string, vault_indices> &_map_tag_index()
+{
+    if (!map_tag_index_built)
+    {
+        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+            for (const string &tag : vdefs[i].get_tags_unsorted())
+                map_tag_index[tag].push_back(i);
+        map_tag_index_built = true;
+    }
+    return map_tag_index;
+}
+
+// The maps having all of the given tags.
+static vault_indices _maps_with_all_tags(const unordered_set<string> &tags)
+{
+    vault_indices result;
+    const auto &index = _map_tag_index();
+    bool first = true;
+    for (const string &tag : tags)
+    {
+        auto maps = index.find(tag);
+        if (maps == index.end())
+            return vault_indices();
+
+        if (first)
+            result = maps->second;
+        else
+        {
+            vault_indices both;
+            set_intersection(result.begin(), result.end(),
+                             maps->second.begin(), maps->second.end(),
+                             back_inserter(both));
+            result.swap(both);
+        }
+        first = false;
+    }
+    // An empty tag list matches nothing, as in map_def::has_all_tags().
+    return result;
+}
+
+// The checks in map_selector::depth_selectable() that depend only on the
+// map's tags.
+static bool _tags_depth_selectable(const map_def &mapdef)
+{
+    // Some tagged levels cannot be selected as random
+    // maps in a specific depth:
+    return !mapdef.has_tag_suffix("entry")
+           && !mapdef.has_tag("unrand")
+           && !mapdef.has_tag("place_unique")
+           && !mapdef.has_tag("tutorial")
+           && (!mapdef.has_tag_prefix("temple_")
+               || mapdef.has_tag_prefix("uniq_altar_"));
+}
+
+static const level_map_indices &_maps_for_level(const level_id &place)
+{
+    // Depth ranges ending in the last level of a branch depend on the
+    // branch's depth, which may change between games.
+    const int branch_depth = brdepth[place.branch];
+    auto cached = map_depth_index.find(place);
+    if (cached != map_depth_index.end()
+        && cached->second.branch_depth == branch_depth)
+    {
+        return cached->second;
+    }
+
+    level_map_indices &maps = map_depth_index[place];
+    maps = level_map_indices();
+    maps.branch_depth = branch_depth;
+    for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+    {
+        const map_def &mapdef = vdefs[i];
+        if (mapdef.place.is_usable_in(place))
+            maps.by_place.push_back(i);
+
+        if (!mapdef.is_usable_in(place) || !_tags_depth_selectable(mapdef))
+            continue;
+
+        const bool chance = mapdef.chance(place).valid();
+        const bool dummy = mapdef.has_tag("dummy");
+        if (!chance || dummy)
+            maps.by_depth.push_back(i);
+        if (chance && !dummy)
+            maps.by_chance.push_back(i);
+    }
+    return maps;
+}
+
 mapref_vector find_maps_for_tag(const string &tag,
                                 bool check_depth,
                                 bool check_used)
@@ -746,10 +870,10 @@ mapref_vector find_maps_for_tag(const string &tag,
     level_id place = level_id::current();
     unordered_set<string> tag_set = parse_tags(tag);
 
-    for (const map_def &mapdef : vdefs)
+    for (unsigned i : _maps_with_all_tags(tag_set))
     {
-        if (mapdef.has_all_tags(tag_set.begin(), tag_set.end())
-            && !mapdef.has_tag("dummy")
+        const map_def &mapdef = vdefs[i];
+        if (!mapdef.has_tag("dummy")
             && (!check_depth || _debug_ignore_depth
                 || !mapdef.has_depth()
                 || mapdef.is_usable_in(place))
@@ -774,6 +898,7 @@ private:
 
 public:
     bool accept(const map_def &md) const;
+    vault_indices candidates() const;
     void announce(const map_def *map) const;
 
     bool valid() const
@@ -846,14 +971,7 @@ public:
 bool map_selector::depth_selectable(const map_def &mapdef) const
 {
     return mapdef.is_usable_in(place)
-           // Some tagged levels cannot be selected as random
-           // maps in a specific depth:
-           && !mapdef.has_tag_suffix("entry")
-           && !mapdef.has_tag("unrand")
-           && !mapdef.has_tag("place_unique")
-           && !mapdef.has_tag("tutorial")
-           && (!mapdef.has_tag_prefix("temple_")
-               || mapdef.has_tag_prefix("uniq_altar_"))
+           && _tags_depth_selectable(mapdef)
            && _map_matches_species(mapdef)
            && (!check_layout || _map_matches_layout_type(mapdef));
 }
@@ -917,6 +1035,25 @@ bool map_selector::accept(const map_def &mapdef) const
     }
 }
 
+// The maps that accept() could possibly return true for: every map it
+// accepts is in this list, in vdefs order.
+vault_indices map_selector::candidates() const
+{
+    switch (sel)
+    {
+    case PLACE:
+        return _maps_for_level(place).by_place;
+    case DEPTH:
+        return _maps_for_level(place).by_depth;
+    case DEPTH_AND_CHANCE:
+        return _maps_for_level(place).by_chance;
+    case TAG:
+        return _maps_with_all_tags(parse_tags(tag));
+    default:
+        return vault_indices();
+    }
+}
+
 void map_selector::announce(const map_def *vault) const
 {
 #ifdef DEBUG_DIAGNOSTICS
@@ -957,15 +1094,13 @@ string vault_chance_tag(const map_def &map)
     return "";
 }
 
-typedef vector<unsigned> vault_indices;
-
 static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 {
     vault_indices eligible;
 
     if (sel.valid())
     {
-        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+        for (unsigned i : sel.candidates())
             if (sel.accept(vdefs[i]))
                 eligible.push_back(i);
     }
@@ -1278,9 +1413,30 @@ static bool _verify_map_full(const string &base, time_t mtime)
     return verify_file_version(base + ".dsc", mtime);
 }
 
+static void _read_map_index_entries(reader &inf, const string &cache)
+{
+    const int nmaps = unmarshallShort(inf);
+    const int nexist = vdefs.size();
+    vdefs.resize(nexist + nmaps, map_def());
+    _reset_map_selection_index();
+    for (int i = 0; i < nmaps; ++i)
+    {
+        map_def &vdef(vdefs[nexist + i]);
+        vdef.read_index(inf);
+        vdef.description = unmarshallString(inf);
+        vdef.order = unmarshallInt(inf);
+
+        vdef.set_file(cache);
+        lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
+        vdef.place_loaded_from.clear();
+    }
+}
+
 static bool _load_map_index(const string& cache, const string &base,
                             time_t mtime)
 {
+    lc_global_prelude.clear();
+
     // If there's a global prelude, load that first.
     if (FILE *fp = fopen_u((base + ".lux").c_str(), "rb"))
     {
@@ -1323,20 +1479,7 @@ static bool _load_map_index(const string& cache, const string &base,
         return false;
 #endif
 
-    const int nmaps = unmarshallShort(inf);
-    const int nexist = vdefs.size();
-    vdefs.resize(nexist + nmaps, map_def());
-    for (int i = 0; i < nmaps; ++i)
-    {
-        map_def &vdef(vdefs[nexist + i]);
-        vdef.read_index(inf);
-        vdef.description = unmarshallString(inf);
-        vdef.order = unmarshallInt(inf);
-
-        vdef.set_file(cache);
-        lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
-        vdef.place_loaded_from.clear();
-    }
+    _read_map_index_entries(inf, cache);
     fclose(fp);
 
     return true;
@@ -1436,6 +1579,176 @@ static void _write_map_cache(const string &filename, size_t vs, size_t ve,
     _write_map_index(descache_base, vs, ve, mtime);
 }
 
+////////////////////////////////////////////////////////////////////////////
+// The vault index
+//
+// A single file holding the global prelude and index entries of every des
+// file read by read_maps(), so that startup maps one cache file instead of
+// opening and reading the .lux, .idx and .dsc of each des file in turn.
+// Map bodies stay in the per-file .dsc caches, and are only read when a map
+// is actually used (see map_def::load()).
+//
+// The file is an MMAP_DBM keyed by des cache name, and an entry is decoded
+// straight from the mapping when its des file is read. Each entry records
+// the des file's mtime. A des file whose entry is missing or out of date, or
+// whose .dsc no longer has a matching header, falls back to the per-file
+// caches (reparsing it if needed), and the index is rewritten at the end of
+// read_maps().
+
+struct des_file_maps
+{
+    string cache_name;
+    int64_t mtime;
+    dlua_chunk prelude;
+    size_t start, end; // range in vdefs
+};
+
+static unique_ptr<MMAP_DBM> vault_index;
+static int vault_index_files = 0;
+static vector<des_file_maps> des_files_read;
+static bool vault_index_stale = false;
+
+static string _vault_index_base()
+{
+    return _des_cache_dir("vault_index");
+}
+
+// Des files are stored under their cache names. The empty key holds the save
+// version, word length and number of des files of the whole index.
+static mmap_datum _vault_index_key(const string &cache_name)
+{
+    mmap_datum key;
+    key.dptr = const_cast<char *>(cache_name.data());
+    key.dsize = cache_name.size();
+    return key;
+}
+
+static void _read_vault_index()
+{
+    vault_index.reset();
+    vault_index_files = 0;
+    des_files_read.clear();
+    vault_index_stale = false;
+
+    _check_des_index_dir();
+    unique_ptr<MMAP_DBM> index(new MMAP_DBM(_vault_index_base(), false));
+    if (!index->open())
+        return;
+
+    const mmap_datum header = index->fetch(_vault_index_key(""));
+    reader inf((const unsigned char *) header.dptr, header.dsize,
+               TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+    try
+    {
+        const auto version = get_save_version(inf);
+        const int8_t word = unmarshallByte(inf);
+        if (version.major == TAG_MAJOR_VERSION
+            && version.minor == TAG_MINOR_VERSION
+            && word == WORD_LEN)
+        {
+            vault_index_files = unmarshallInt(inf);
+            vault_index = move(index);
+        }
+    }
+    catch (short_read_exception &E)
+    {
+    }
+}
+
+static bool _load_maps_from_vault_index(const string &cache_name,
+                                        time_t mtime)
+{
+    if (!vault_index)
+        return false;
+
+    const mmap_datum entry = vault_index->fetch(_vault_index_key(cache_name));
+    if (!entry.dptr)
+        return false;
+
+    reader inf((const unsigned char *) entry.dptr, entry.dsize,
+               TAG_MINOR_VERSION);
+    inf.set_safe_read(true);
+    const size_t file_start = vdefs.size();
+    try
+    {
+        // The map bodies are read from the .dsc later, so check that it is
+        // still the one the index entries point into.
+        if (unmarshallSigned(inf) != mtime
+            || !_verify_map_full(get_descache_path(cache_name, ""), mtime))
+        {
+            return false;
+        }
+
+        lc_global_prelude.read(inf);
+        _read_map_index_entries(inf, cache_name);
+    }
+    catch (short_read_exception &E)
+    {
+        lc_global_prelude.clear();
+        vdefs.resize(file_start);
+        _reset_map_selection_index();
+        return false;
+    }
+    if (!lc_global_prelude.empty())
+        global_preludes.push_back(lc_global_prelude);
+    return true;
+}
+
+static void _write_vault_index()
+{
+    const string base = _vault_index_base();
+    file_lock lock(base + ".lk", "wb");
+
+    MMAP_DBM index(base, true);
+
+    vector<unsigned char> header;
+    writer headerf(&header);
+    write_save_version(headerf, save_version::current());
+    marshallByte(headerf, WORD_LEN);
+    marshallInt(headerf, des_files_read.size());
+    mmap_datum value;
+    value.dptr = (char *) header.data();
+    value.dsize = header.size();
+    index.store(_vault_index_key(""), value);
+
+    for (const des_file_maps &des : des_files_read)
+    {
+        vector<unsigned char> data;
+        writer dataf(&data);
+        marshallSigned(dataf, des.mtime);
+        des.prelude.write(dataf);
+        marshallShort(dataf, des.end - des.start);
+        for (size_t i = des.start; i < des.end; ++i)
+        {
+            map_def &vdef(vdefs[i]);
+            vdef.place_loaded_from = lc_loaded_maps[vdef.name];
+            vdef.write_index(dataf);
+            marshallString(dataf, vdef.description);
+            marshallInt(dataf, vdef.order);
+            vdef.place_loaded_from.clear();
+        }
+
+        value.dptr = (char *) data.data();
+        value.dsize = data.size();
+        index.store(_vault_index_key(des.cache_name), value);
+    }
+
+    // Not fatal: the per-file caches are still there.
+    if (!index.close())
+        dprf("Unable to write %s", index.dbfile.c_str());
+}
+
+static bool _load_maps(const string &filename, const string &cache_name,
+                       time_t mtime)
+{
+    if (_load_maps_from_vault_index(cache_name, mtime))
+        return true;
+
+    vault_index_stale = true;
+    return _load_map_cache(filename, cache_name);
+}
+
 static void _parse_maps(const string &s)
 {
     string cache_name = get_cache_name(s);
@@ -1444,8 +1757,14 @@ static void _parse_maps(const string &s)
 
     map_files_read.insert(cache_name);
 
-    if (_load_map_cache(s, cache_name))
+    const size_t file_start = vdefs.size();
+    const time_t des_mtime = file_modtime(s);
+    if (_load_maps(s, cache_name, des_mtime))
+    {
+        des_files_read.push_back({ cache_name, des_mtime, lc_global_prelude,
+                                   file_start, vdefs.size() });
         return;
+    }
 
     FILE *dat = fopen_u(s.c_str(), "r");
     if (!dat)
@@ -1464,13 +1783,14 @@ static void _parse_maps(const string &s)
     extern FILE *yyin;
     yyin = dat;
 
-    const size_t file_start = vdefs.size();
     yyparse();
     fclose(dat);
 
     global_preludes.push_back(lc_global_prelude);
 
     _write_map_cache(cache_name, file_start, vdefs.size(), mtime);
+    des_files_read.push_back({ cache_name, mtime, lc_global_prelude,
+                               file_start, vdefs.size() });
 }
 
 void read_map(const string &file)
@@ -1483,9 +1803,18 @@ void read_map(const string &file)
 
 void read_maps()
 {
+    _read_vault_index();
+
     if (dlua.execfile("dlua/loadmaps.lua", true, true, true))
         end(1, false, "Lua error: %s", dlua.error.c_str());
 
+    if (vault_index_stale || !vault_index
+        || vault_index_files != (int) des_files_read.size())
+    {
+        _write_vault_index();
+    }
+    vault_index.reset();
+
     lc_loaded_maps.clear();
 
     {
@@ -1509,6 +1838,7 @@ void reread_maps()
 
     // BOOM!
     vdefs.clear();
+    _reset_map_selection_index();
     map_files_read.clear();
     read_maps();
 }
@@ -1528,6 +1858,7 @@ void add_parsed_map(const map_def &md)
 
     map.fixup();
     vdefs.push_back(map);
+    _reset_map_selection_index();
 }
 
 void run_map_global_preludes()
@@ -128,9 +128,16 @@ protected:
         formatted_string text;
         vector<tile_def> tiles;
         bool heading;
+        bool formatted = false;
     };
     vector<MenuItemInfo> item_info;
     vector<int> row_heights;
+    vector<int> row_first_item;
+    // Widest text of the entries formatted by update_items(), which stands
+    // in for all of them in an MF_VIRTUALIZE menu.
+    int m_virtual_width = 0;
+
+    void format_item(int index);
 
     bool m_mouse_pressed = false;
     int m_mouse_idx = -1, m_mouse_x = -1, m_mouse_y = -1;
@@ -148,6 +155,10 @@ protected:
 public:
     static constexpr int item_pad = 2;
     static constexpr int pad_right = 10;
+    // Entries of an MF_VIRTUALIZE menu formatted up front, and formatted
+    // either side of the visible ones.
+    static constexpr int virtual_first_page = 52;
+    static constexpr int virtual_overscan = 10;
 #else
     int m_shown_height {0};
 #endif
@@ -164,10 +175,27 @@ void UIMenu::update_items()
         update_item(i);
 
 #ifdef USE_TILE_LOCAL
+    if (m_menu->is_set(MF_VIRTUALIZE))
+    {
+        // Only the first page decides the column width and whether to draw
+        // tiles; the rest are formatted when they're scrolled to.
+        m_virtual_width = 0;
+        const int page = min((int)item_info.size(), virtual_first_page);
+        for (int i = 0; i < page; ++i)
+        {
+            format_item(i);
+            if (!item_info[i].heading)
+            {
+                m_virtual_width = max(m_virtual_width,
+                        (int)m_font_entry->string_width(item_info[i].text));
+            }
+        }
+    }
+
     // update m_draw_tiles
     m_draw_tiles = false;
     for (const auto& entry : item_info)
-        if (!entry.heading && !entry.tiles.empty())
+        if (entry.formatted && !entry.heading && !entry.tiles.empty())
         {
             m_draw_tiles = Options.tile_menu_icons;
             break;
@@ -181,22 +209,20 @@ void UIMenu::is_visible_item_range(int *vis_min, int *vis_max)
     const int scroll = m_menu->m_ui.scroller->get_scroll();
 
 #ifdef USE_TILE_LOCAL
-    int v_min = 0, v_max = item_info.size(), i;
-    for (i = 0; i < (int)item_info.size(); ++i)
-    {
-        if (row_heights[item_info[i].row + 1] > scroll)
-        {
-            v_min = i;
-            break;
-        }
-    }
-    for (; i < (int)item_info.size(); ++i)
-    {
-        if (row_heights[item_info[i].row] >= scroll + viewport_height)
-        {
-            v_max = i;
-            break;
-        }
+    // row_heights holds the top of each row, then the bottom of the last.
+    int v_min = 0, v_max = item_info.size();
+    const int rows = row_first_item.size();
+    const int first_row = upper_bound(row_heights.begin(), row_heights.end(),
+                                      scroll) - row_heights.begin() - 1;
+    if (first_row >= 0 && first_row < rows)
+    {
+        v_min = row_first_item[first_row];
+        const int end_row = lower_bound(row_heights.begin() + first_row,
+                                        row_heights.begin() + rows,
+                                        scroll + viewport_height)
+                            - row_heights.begin();
+        if (end_row < rows)
+            v_max = row_first_item[end_row];
     }
 #else
     int v_min = scroll;
@@ -232,24 +258,38 @@ void UIMenu::update_item(int index)
     _queue_allocation();
 #ifdef USE_TILE_LOCAL
     const MenuEntry *me = m_menu->items[index];
+
+    item_info.resize(m_menu->items.size());
+
+    auto& entry = item_info[index];
+    entry.heading = me->level == MEL_TITLE || me->level == MEL_SUBTITLE;
+    if (m_menu->is_set(MF_VIRTUALIZE))
+        entry.formatted = false;
+    else
+        format_item(index);
+#else
+    UNUSED(index);
+#endif
+}
+
+#ifdef USE_TILE_LOCAL
+void UIMenu::format_item(int index)
+{
+    const MenuEntry *me = m_menu->items[index];
     int colour = m_menu->item_colour(me);
     const bool needs_cursor = (m_menu->get_cursor() == index
                                && m_menu->is_set(MF_MULTISELECT));
     string text = me->get_text(needs_cursor);
 
-    item_info.resize(m_menu->items.size());
-
     auto& entry = item_info[index];
     entry.text.clear();
     entry.text.textcolour(colour);
     entry.text += formatted_string::parse_string(text);
-    entry.heading = me->level == MEL_TITLE || me->level == MEL_SUBTITLE;
     entry.tiles.clear();
     me->get_tiles(entry.tiles);
-#else
-    UNUSED(index);
-#endif
+    entry.formatted = true;
 }
+#endif
 
 #ifdef USE_TILE_LOCAL
 static bool _has_hotkey_prefix(const string &s)
@@ -267,6 +307,10 @@ void UIMenu::do_layout(int mw, int num_columns)
     const int max_column_width = mw / num_columns;
     const int text_height = m_font_entry->char_height();
 
+    // Virtualized menus lay out every entry as one line of the same height,
+    // so that they needn't be formatted first.
+    const bool virtualized = m_menu->is_set(MF_VIRTUALIZE);
+
     int column = -1; // an initial increment makes this 0
     int column_width = 0;
     int row_height = 0;
@@ -274,6 +318,7 @@ void UIMenu::do_layout(int mw, int num_columns)
 
     row_heights.clear();
     row_heights.reserve(m_menu->items.size()+1);
+    row_first_item.clear();
 
     for (size_t i = 0; i < m_menu->items.size(); ++i)
     {
@@ -286,10 +331,13 @@ void UIMenu::do_layout(int mw, int num_columns)
             row_height += row_height == 0 ? 0 : 2*item_pad;
             height += row_height;
             row_heights.push_back(height);
+            row_first_item.push_back(i);
             row_height = 0;
         }
 
-        const int text_width = m_font_entry->string_width(entry.text);
+        const int text_width = !virtualized ? m_font_entry->string_width(entry.text)
+                               : entry.heading ? 0
+                               : m_virtual_width;
 
         entry.y = height;
         entry.row = row_heights.size() - 1;
@@ -317,10 +365,12 @@ void UIMenu::do_layout(int mw, int num_columns)
 
             entry.x = text_indent;
             int text_sx = text_indent;
-            int item_height = max(text_height, !entry.tiles.empty() ? 32 : 0);
+            const bool has_tiles = virtualized ? m_draw_tiles
+                                               : !entry.tiles.empty();
+            int item_height = max(text_height, has_tiles ? 32 : 0);
 
             // Split menu entries that don't fit into a single line into two lines.
-            if (!m_menu->is_set(MF_NO_WRAP_ROWS))
+            if (!m_menu->is_set(MF_NO_WRAP_ROWS) && !virtualized)
             if ((text_width > max_column_width-entry.x-pad_right))
             {
                 formatted_string text;
@@ -705,6 +755,17 @@ void UIMenu::pack_buffers()
     int vis_min, vis_max;
     is_visible_item_range(&vis_min, &vis_max);
 
+    if (m_menu->is_set(MF_VIRTUALIZE))
+    {
+        // A few more either side, so that scrolling by a line or two finds
+        // them ready.
+        const int first = max(0, vis_min - virtual_overscan);
+        const int last = min((int)item_info.size(), vis_max + virtual_overscan);
+        for (int i = first; i < last; ++i)
+            if (!item_info[i].formatted)
+                format_item(i);
+    }
+
     for (int i = vis_min; i < vis_max; ++i)
     {
         const auto& entry = item_info[i];
@@ -759,7 +820,8 @@ void UIMenu::pack_buffers()
             // Line wrap and render the remaining text
             int w = entry_ex-text_sx - pad_right;
             int h = m_font_entry->char_height();
-            h *= m_menu->is_set(MF_NO_WRAP_ROWS) ? 1 : 2;
+            h *= m_menu->is_set(MF_NO_WRAP_ROWS)
+                 || m_menu->is_set(MF_VIRTUALIZE) ? 1 : 2;
             formatted_string split = m_font_entry->split(text, w, h);
             int string_height = m_font_entry->string_height(split);
             text_sy = entry.y + (entry_h - string_height)/2;
@@ -1379,15 +1441,21 @@ void Menu::deselect_all(bool update_view)
 
 int Menu::get_first_visible() const
 {
+    // Items never end above the ones before them, so binary search for the
+    // first that ends below the top of the view.
     int y = m_ui.scroller->get_scroll();
-    for (int i = 0; i < (int)items.size(); i++)
+    int lo = 0, hi = items.size();
+    while (lo < hi)
     {
+        const int mid = lo + (hi - lo) / 2;
         int item_y2;
-        m_ui.menu->get_item_region(i, nullptr, &item_y2);
+        m_ui.menu->get_item_region(mid, nullptr, &item_y2);
         if (item_y2 > y)
-            return i;
+            hi = mid;
+        else
+            lo = mid + 1;
     }
-    return items.size();
+    return lo;
 }
 
 bool Menu::is_hotkey(int i, int key)
@@ -1902,8 +1970,7 @@ void Menu::update_menu(bool update_entries)
         tiles.json_write_int("total_items", items.size());
         tiles.json_close_object();
         tiles.finish_message();
-        if (items.size() > 0)
-            webtiles_update_items(0, items.size() - 1);
+        webtiles_update_all_items();
     }
 #else
     UNUSED(update_entries);
@@ -2093,6 +2160,14 @@ void Menu::webtiles_write_menu(bool replace) const
     int count = items.size();
     int start = 0;
     int end = start + count;
+    // Long virtualized menus only send the page in view; the client asks for
+    // the rest as it's scrolled to.
+    if (is_set(MF_VIRTUALIZE) && count > WEBTILES_MENU_PAGE)
+    {
+        start = is_set(MF_START_AT_END) ? count - WEBTILES_MENU_PAGE
+                                        : webtiles_page_start();
+        end = start + WEBTILES_MENU_PAGE;
+    }
 
     tiles.json_write_int("total_items", count);
     tiles.json_write_int("chunk_start", start);
@@ -2127,7 +2202,7 @@ void Menu::webtiles_scroll(int first)
     }
 }
 
-void Menu::webtiles_handle_item_request(int start, int end)
+void Menu::webtiles_handle_item_request(int start, int end) const
 {
     start = min(max(0, start), (int)items.size()-1);
     if (end < start) end = start;
@@ -2196,6 +2271,35 @@ void Menu::webtiles_update_item(int index) const
     webtiles_update_items(index, index);
 }
 
+// Resend every item. A long virtualized menu has the client drop the items
+// it holds instead, and only sends the page in view again.
+void Menu::webtiles_update_all_items() const
+{
+    const int count = items.size();
+    if (!is_set(MF_VIRTUALIZE) || count <= WEBTILES_MENU_PAGE)
+    {
+        if (count > 0)
+            webtiles_update_items(0, count - 1);
+        return;
+    }
+
+    tiles.json_open_object();
+    tiles.json_write_string("msg", "update_menu");
+    tiles.json_write_bool("reset_items", true);
+    tiles.json_close_object();
+    tiles.finish_message();
+
+    const int start = webtiles_page_start();
+    webtiles_handle_item_request(start, start + WEBTILES_MENU_PAGE - 1);
+}
+
+// The first item of the page in view, for a long virtualized menu.
+int Menu::webtiles_page_start() const
+{
+    const int count = items.size();
+    return max(0, min(get_first_visible(), count - WEBTILES_MENU_PAGE));
+}
+
 void Menu::webtiles_update_title() const
 {
     tiles.json_open_object();
@@ -2460,7 +2564,7 @@ int ToggleableMenu::pre_process(int key)
         update_menu();
 
 #ifdef USE_TILE_WEB
-        webtiles_update_items(0, items.size() - 1);
+        webtiles_update_all_items();
 #endif
 
         if (flags & MF_TOGGLE_ACTION)
@@ -262,6 +262,9 @@ enum MenuFlag
     MF_USE_TWO_COLUMNS  = 0x08000,   ///< Only valid for tiles menus
     MF_UNCANCEL         = 0x10000,   ///< Menu is uncancellable
     MF_SPECIAL_MINUS    = 0x20000,   ///< '-' isn't PGUP or clear multiselect
+    MF_VIRTUALIZE       = 0x40000,   ///< Only format entries as they come into
+                                     ///< view, for very long lists. Rows
+                                     ///< aren't wrapped.
 };
 
 class UIMenu;
@@ -276,6 +279,8 @@ class UIMenuMore;
 // you pass in MUST be allocated with new, or Crawl will crash.
 
 #define NUMBUFSIZ 10
+// How many items of an MF_VIRTUALIZE menu are sent to webtiles at a time.
+#define WEBTILES_MENU_PAGE 100
 
 class Menu
 {
@@ -344,7 +349,7 @@ public:
 #ifdef USE_TILE_WEB
     void webtiles_write_menu(bool replace = false) const;
     void webtiles_scroll(int first);
-    void webtiles_handle_item_request(int start, int end);
+    void webtiles_handle_item_request(int start, int end) const;
 #endif
 protected:
     MenuEntry *title;
@@ -400,6 +405,8 @@ protected:
     void webtiles_write_tiles(const MenuEntry& me) const;
     void webtiles_update_items(int start, int end) const;
     void webtiles_update_item(int index) const;
+    void webtiles_update_all_items() const;
+    int webtiles_page_start() const;
     void webtiles_update_title() const;
     void webtiles_update_scroll_pos() const;
 
@@ -7,6 +7,7 @@
 
 #include "message.h"
 
+#include <bitset>
 #include <sstream>
 
 #include "areas.h"
@@ -1344,15 +1345,165 @@ void dprf(diag_type param, const char *format, ...)
 
 static bool _updating_view = false;
 
+#define FILTER_TRIGRAM_BITS 1024
+
+static unsigned int _filter_trigram(const char *s)
+{
+    return ((unsigned char) s[0] * 961 + (unsigned char) s[1] * 31
+            + (unsigned char) s[2]) % FILTER_TRIGRAM_BITS;
+}
+
+static string _filter_lowercase(const string &s)
+{
+    // ASCII only, to agree with regex_literals().
+    string lower = s;
+    for (char &c : lower)
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+    return lower;
+}
+
+/**
+ * A message filter option compiled for matching many filters at once.
+ *
+ * Filters are grouped by the channels they apply to. Each filter is tagged
+ * with the longest literal string that any message it matches must contain,
+ * and the regex is only tried on messages containing that literal. One pass
+ * over the message records its trigrams, which rules out most filters with
+ * a single bit test.
+ */
+class compiled_message_filters
+{
+public:
+    compiled_message_filters(const char *_name)
+        : name(_name), generation(0)
+    {
+    }
+
+    bool stale() const
+    {
+        return generation != Options.message_filter_generation;
+    }
+
+    void build(const vector<message_filter> &source)
+    {
+        generation = Options.message_filter_generation;
+
+        filters.clear();
+        for (const message_filter &mf : source)
+        {
+            compiled_filter cf = { mf, "", 0, 0 };
+            vector<string> runs;
+            if (regex_literals(mf.pattern.tostring(), runs))
+            {
+                for (const string &run : runs)
+                    if (run.size() > cf.literal.size())
+                        cf.literal = run;
+                if (!cf.literal.empty())
+                    cf.trigram = _filter_trigram(cf.literal.c_str());
+            }
+            filters.push_back(cf);
+        }
+
+        for (int ch = 0; ch < NUM_MESSAGE_CHANNELS; ++ch)
+        {
+            by_channel[ch].clear();
+            for (int i = 0, size = filters.size(); i < size; ++i)
+                if (filters[i].filter.channel == ch
+                    || filters[i].filter.channel == -1)
+                {
+                    by_channel[ch].push_back(i);
+                }
+        }
+    }
+
+    /// The index of the first filter matching the message, or -1.
+    int find(msg_channel_type channel, const string &message)
+    {
+        const vector<int> &candidates = by_channel[channel];
+        if (candidates.empty())
+            return -1;
+
+        const string lower = _filter_lowercase(message);
+        bitset<FILTER_TRIGRAM_BITS> trigrams;
+        for (size_t i = 0; i + 3 <= lower.size(); ++i)
+            trigrams.set(_filter_trigram(&lower[i]));
+
+        for (int i : candidates)
+        {
+            compiled_filter &cf = filters[i];
+            if (!cf.literal.empty()
+                && (!trigrams[cf.trigram]
+                    || lower.find(cf.literal) == string::npos))
+            {
+                continue;
+            }
+            if (cf.filter.pattern.empty() || cf.filter.pattern.matches(message))
+            {
+                ++cf.hits;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void add_stats(vector<message_filter_stat> &stats) const
+    {
+        for (const compiled_filter &cf : filters)
+        {
+            const int ch = cf.filter.channel;
+            stats.push_back({ name,
+                              (ch == -1 ? "" : channel_to_str(ch) + ":")
+                              + cf.filter.pattern.tostring(),
+                              cf.hits });
+        }
+    }
+
+private:
+    struct compiled_filter
+    {
+        message_filter filter;
+        string literal;
+        unsigned int trigram;
+        unsigned int hits;
+    };
+
+    const char *name;
+    unsigned int generation;
+    vector<compiled_filter> filters;
+    vector<int> by_channel[NUM_MESSAGE_CHANNELS];
+};
+
+static compiled_message_filters more_filters("force_more_message");
+static compiled_message_filters flash_filters("flash_screen_message");
+static compiled_message_filters colour_filters("message_colour");
+
+static void _update_colour_filters()
+{
+    vector<message_filter> filters;
+    for (const message_colour_mapping &mcm : Options.message_colour_mappings)
+        filters.push_back(mcm.message);
+    colour_filters.build(filters);
+}
+
+vector<message_filter_stat> message_filter_stats()
+{
+    vector<message_filter_stat> stats;
+    more_filters.add_stats(stats);
+    flash_filters.add_stats(stats);
+    colour_filters.add_stats(stats);
+    return stats;
+}
+
 static bool _check_option(const string& line, msg_channel_type channel,
+                          compiled_message_filters &filters,
                           const vector<message_filter>& option)
 {
     if (crawl_state.generating_level)
         return false;
-    return any_of(begin(option),
-                  end(option),
-                  bind(mem_fn(&message_filter::is_filtered),
-                       placeholders::_1, channel, line));
+    if (filters.stale())
+        filters.build(option);
+    return filters.find(channel, line) != -1;
 }
 
 static bool _check_more(const string& line, msg_channel_type channel)
@@ -1362,7 +1513,8 @@ static bool _check_more(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.force_more_message);
+    return _check_option(line, channel, more_filters,
+                         Options.force_more_message);
 }
 
 static bool _check_flash_screen(const string& line, msg_channel_type channel)
@@ -1372,7 +1524,8 @@ static bool _check_flash_screen(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.flash_screen_message);
+    return _check_option(line, channel, flash_filters,
+                         Options.flash_screen_message);
 }
 
 static bool _check_join(const string& /*line*/, msg_channel_type channel)
@@ -1801,14 +1954,11 @@ static msg_colour_type prepare_message(const string& imsg,
 
     if (!crawl_state.generating_level)
     {
-        for (const message_colour_mapping &mcm : Options.message_colour_mappings)
-        {
-            if (mcm.message.is_filtered(channel, imsg))
-            {
-                colour = mcm.colour;
-                break;
-            }
-        }
+        if (colour_filters.stale())
+            _update_colour_filters();
+        const int i = colour_filters.find(channel, imsg);
+        if (i != -1)
+            colour = Options.message_colour_mappings[i].colour;
     }
 
     return colour;
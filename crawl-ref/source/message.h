@@ -46,6 +46,16 @@ class formatted_string;
 void formatted_mpr(const formatted_string& fs,
                    msg_channel_type channel = MSGCH_PLAIN, int param = 0);
 
+struct message_filter_stat
+{
+    string option;
+    string pattern;
+    unsigned int hits;
+};
+
+// How often each message filter option has matched, for tuning rc files.
+vector<message_filter_stat> message_filter_stats();
+
 // mpr() an arbitrarily long list of strings
 void mpr_comma_separated_list(const string &prefix,
                               const vector<string> &list,
@@ -0,0 +1,283 @@
+/**
+ * @file
+ * @brief dbm wrapper for a sorted, memory-mapped file
+**/
+
+#include "AppHdr.h"
+
+#include "mmapdbm.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef TARGET_OS_WINDOWS
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "end.h"
+#include "syscalls.h"
+
+// File layout, in native byte order since the file is only a cache:
+//   header: magic, version, number of entries, unused
+//   entries: one MMAP_DBM::entry per key, sorted by key
+//   data: the keys and values the entries point to
+#define MMAP_DBM_MAGIC   0x4d424443 // "CDBM"
+#define MMAP_DBM_VERSION 1
+#define MMAP_DBM_HEADER  (4 * sizeof(uint32_t))
+
+MMAP_DBM::MMAP_DBM(const string &db, bool _writing)
+    : dbfile(db), writing(_writing), pending(), pending_pos(),
+      base(nullptr), size(0), count(0), entries(nullptr), pos(0)
+{
+    if (dbfile.find(".db") != dbfile.length() - 3)
+        dbfile += ".db";
+}
+
+MMAP_DBM::~MMAP_DBM()
+{
+#ifndef TARGET_OS_WINDOWS
+    if (base)
+        munmap((void *) base, size);
+#endif
+}
+
+bool MMAP_DBM::open()
+{
+    if (writing)
+        return true;
+
+#ifdef TARGET_OS_WINDOWS
+    FILE *f = fopen_u(dbfile.c_str(), "rb");
+    if (!f)
+        return false;
+    char buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        contents.append(buf, got);
+    fclose(f);
+    if (contents.size() < MMAP_DBM_HEADER)
+        return false;
+    size = contents.size();
+    base = contents.data();
+#else
+    int fd = open_u(dbfile.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t) st.st_size < MMAP_DBM_HEADER)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    base = (const char *) map;
+#endif
+
+    const uint32_t *header = (const uint32_t *) base;
+    count = header[2];
+    entries = (const entry *) (base + MMAP_DBM_HEADER);
+    if (header[0] != MMAP_DBM_MAGIC || header[1] != MMAP_DBM_VERSION
+        || count > (size - MMAP_DBM_HEADER) / sizeof(entry))
+    {
+        return false;
+    }
+
+    // Check everything once here, so that lookups needn't.
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const entry &e = entries[i];
+        if ((size_t) e.key_off + e.key_len > size
+            || (size_t) e.value_off + e.value_len > size)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MMAP_DBM::close()
+{
+    return !writing || write_file();
+}
+
+bool MMAP_DBM::write_file() const
+{
+    vector<entry> index;
+    uint32_t off = MMAP_DBM_HEADER + pending.size() * sizeof(entry);
+    for (const auto &kv : pending)
+    {
+        entry e;
+        e.key_off = off;
+        e.key_len = kv.first.size();
+        off += e.key_len;
+        e.value_off = off;
+        e.value_len = kv.second.size();
+        off += e.value_len;
+        index.push_back(e);
+    }
+
+    const uint32_t header[4] =
+    {
+        MMAP_DBM_MAGIC, MMAP_DBM_VERSION, (uint32_t) pending.size(), 0
+    };
+
+    // Write everything to the side and move it into place, so that readers
+    // never see a partial file.
+    const string tmpfile = dbfile + ".new";
+    FILE *f = fopen_u(tmpfile.c_str(), "wb");
+    if (!f)
+        return false;
+
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1
+              && (index.empty()
+                  || fwrite(&index[0], sizeof(entry), index.size(), f)
+                     == index.size());
+    for (auto i = pending.begin(); ok && i != pending.end(); ++i)
+    {
+        ok = fwrite(i->first.data(), 1, i->first.size(), f) == i->first.size()
+             && fwrite(i->second.data(), 1, i->second.size(), f)
+                == i->second.size();
+    }
+
+    if (fclose(f) || !ok || rename_u(tmpfile.c_str(), dbfile.c_str()))
+    {
+        unlink_u(tmpfile.c_str());
+        return false;
+    }
+    return true;
+}
+
+mmap_datum MMAP_DBM::key_at(uint32_t i) const
+{
+    mmap_datum key;
+    key.dptr = (char *) base + entries[i].key_off;
+    key.dsize = entries[i].key_len;
+    return key;
+}
+
+static int _compare_keys(const char *a, size_t alen, const char *b, size_t blen)
+{
+    const int cmp = memcmp(a, b, min(alen, blen));
+    if (cmp)
+        return cmp;
+    return alen < blen ? -1 : alen > blen ? 1 : 0;
+}
+
+mmap_datum MMAP_DBM::fetch(const mmap_datum &key) const
+{
+    mmap_datum value;
+
+    if (writing)
+    {
+        auto i = pending.find(string(key.dptr, key.dsize));
+        if (i != pending.end())
+        {
+            value.dptr = (char *) i->second.data();
+            value.dsize = i->second.size();
+        }
+        return value;
+    }
+
+    uint32_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const entry &e = entries[mid];
+        const int cmp = _compare_keys(base + e.key_off, e.key_len,
+                                      key.dptr, key.dsize);
+        if (cmp < 0)
+            lo = mid + 1;
+        else if (cmp > 0)
+            hi = mid;
+        else
+        {
+            value.dptr = (char *) base + e.value_off;
+            value.dsize = e.value_len;
+            break;
+        }
+    }
+    return value;
+}
+
+mmap_datum MMAP_DBM::firstkey()
+{
+    pending_pos = pending.begin();
+    pos = 0;
+    return nextkey();
+}
+
+mmap_datum MMAP_DBM::nextkey()
+{
+    mmap_datum key;
+    if (writing)
+    {
+        if (pending_pos != pending.end())
+        {
+            key.dptr = (char *) pending_pos->first.data();
+            key.dsize = pending_pos->first.size();
+            ++pending_pos;
+        }
+    }
+    else if (pos < count)
+        key = key_at(pos++);
+    return key;
+}
+
+void MMAP_DBM::store(const mmap_datum &key, const mmap_datum &value)
+{
+    ASSERT(writing);
+    pending[string(key.dptr, key.dsize)] = string(value.dptr, value.dsize);
+}
+
+#ifdef USE_MMAP_DBM
+
+MMAP_DBM *dbm_open(const char *filename, int open_mode, int)
+{
+    MMAP_DBM *db = new MMAP_DBM(filename, (open_mode & O_ACCMODE) != O_RDONLY);
+    if (!db->open())
+    {
+        delete db;
+        return nullptr;
+    }
+    return db;
+}
+
+int dbm_close(MMAP_DBM *db)
+{
+    if (!db->close())
+        end(1, true, "Unable to write DB: %s", db->dbfile.c_str());
+    delete db;
+    return 0;
+}
+
+mmap_datum dbm_fetch(MMAP_DBM *db, const mmap_datum &key)
+{
+    return db->fetch(key);
+}
+
+mmap_datum dbm_firstkey(MMAP_DBM *db)
+{
+    return db->firstkey();
+}
+
+mmap_datum dbm_nextkey(MMAP_DBM *db)
+{
+    return db->nextkey();
+}
+
+int dbm_store(MMAP_DBM *db, const mmap_datum &key, const mmap_datum &value,
+              int)
+{
+    db->store(key, value);
+    return 0;
+}
+
+#endif // USE_MMAP_DBM
@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief dbm wrapper for a sorted, memory-mapped file
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// A string dbm interface for the text databases, which are written once
+// and then only read. Writing keeps everything in memory until dbm_close(),
+// which writes the entries out sorted by key. Readers map that file and
+// binary search it, so all running games share the same pages and nothing
+// is copied onto the heap.
+//
+// The file is replaced by a rename, so processes that still have an older
+// version mapped keep a consistent copy.
+//
+// The class is also used directly for the vault index (see maps.cc), so it
+// is built even when the databases use another backend. Windows has no
+// mmap(), so there the file is read in instead.
+
+struct mmap_datum
+{
+    mmap_datum() : dptr(nullptr), dsize(0) { }
+
+    char   *dptr;    // Canonically void*, but we're not a real Berkeley DB.
+    size_t dsize;
+};
+
+class MMAP_DBM
+{
+public:
+    MMAP_DBM(const string &db, bool writing);
+    ~MMAP_DBM();
+
+    bool open();
+    bool close();
+
+    mmap_datum fetch(const mmap_datum &key) const;
+    mmap_datum firstkey();
+    mmap_datum nextkey();
+    void store(const mmap_datum &key, const mmap_datum &value);
+
+    string dbfile;
+
+private:
+    struct entry
+    {
+        uint32_t key_off, key_len;
+        uint32_t value_off, value_len;
+    };
+
+    bool write_file() const;
+    mmap_datum key_at(uint32_t i) const;
+
+    bool writing;
+
+    // While writing.
+    map<string, string> pending;
+    map<string, string>::const_iterator pending_pos;
+
+    // While reading.
+#ifdef TARGET_OS_WINDOWS
+    string contents;
+#endif
+    const char *base;
+    size_t size;
+    uint32_t count;
+    const entry *entries;
+    uint32_t pos;
+};
+
+#ifdef USE_MMAP_DBM
+
+#define DBM_REPLACE 1
+
+MMAP_DBM *dbm_open(const char *filename, int open_mode, int permissions);
+int dbm_close(MMAP_DBM *db);
+
+mmap_datum dbm_fetch(MMAP_DBM *db, const mmap_datum &key);
+mmap_datum dbm_firstkey(MMAP_DBM *db);
+mmap_datum dbm_nextkey(MMAP_DBM *db);
+int dbm_store(MMAP_DBM *db, const mmap_datum &key,
+              const mmap_datum &value, int overwrite);
+
+typedef mmap_datum datum;
+typedef MMAP_DBM DBM;
+
+#endif
@@ -2,6 +2,9 @@
 
 #include "mon-pathfind.h"
 
+#include <cstring>
+#include <memory>
+
 #include "directn.h"
 #include "env.h"
 #include "los.h"
@@ -28,6 +31,145 @@
 // then there's no path that matches the requirements fed into monster_pathfind.
 // (These requirements are usually preference of habitat of a specific monster
 // or a limit of the distance between start and any grid on the path.)
+//
+// The per-grid state lives in a pathfind_context. Contexts are kept in a
+// pool and handed out to each monster_pathfind in turn; grids are stamped
+// with the generation of the search that last touched them, so a new
+// search only has to bump the generation instead of clearing the arrays.
+// The "hash" is a bucket queue indexed by total estimated path length,
+// each bucket being an intrusive stack of grids threaded through the
+// context, so pushing and removing grids never allocates.
+
+static const int PF_CELLS = GXM * GYM;
+
+struct pathfind_context
+{
+    pathfind_context() : generation(0)
+    {
+        memset(cell_gen, 0, sizeof(cell_gen));
+        memset(bucket_gen, 0, sizeof(bucket_gen));
+        memset(prev, 0, sizeof(prev));
+    }
+
+    // Start a new search, forgetting everything about the previous one.
+    void begin()
+    {
+        if (++generation == 0)
+        {
+            memset(cell_gen, 0, sizeof(cell_gen));
+            memset(bucket_gen, 0, sizeof(bucket_gen));
+            generation = 1;
+        }
+    }
+
+    int get_dist(const coord_def &p) const
+    {
+        return cell_gen[_index(p)] == generation ? dist[_index(p)]
+                                                 : INFINITE_DISTANCE;
+    }
+
+    void set_dist(const coord_def &p, int d)
+    {
+        _touch(_index(p));
+        dist[_index(p)] = d;
+    }
+
+    bool bucket_empty(int total) const
+    {
+        return bucket_gen[total] != generation || bucket_head[total] < 0;
+    }
+
+    // Push p onto the bucket for the given total length.
+    void push(const coord_def &p, int total)
+    {
+        ASSERT_RANGE(total, 0, PF_CELLS);
+        const int i = _index(p);
+        _touch(i);
+        if (bucket_gen[total] != generation)
+        {
+            bucket_gen[total] = generation;
+            bucket_head[total] = -1;
+        }
+        link_prev[i] = -1;
+        link_next[i] = bucket_head[total];
+        if (bucket_head[total] >= 0)
+            link_prev[bucket_head[total]] = i;
+        bucket_head[total] = i;
+        queued[i] = true;
+    }
+
+    // Take p out of the bucket for the given total length, if it's there.
+    void remove(const coord_def &p, int total)
+    {
+        const int i = _index(p);
+        if (cell_gen[i] != generation || !queued[i])
+            return;
+        if (link_prev[i] >= 0)
+            link_next[link_prev[i]] = link_next[i];
+        else
+            bucket_head[total] = link_next[i];
+        if (link_next[i] >= 0)
+            link_prev[link_next[i]] = link_prev[i];
+        queued[i] = false;
+    }
+
+    // Pop the most recently pushed grid from a non-empty bucket.
+    coord_def pop(int total)
+    {
+        ASSERT(!bucket_empty(total));
+        const int i = bucket_head[total];
+        const coord_def p(i / GYM, i % GYM);
+        remove(p, total);
+        return p;
+    }
+
+    uint32_t generation;
+
+    // Backtracking information; like the original arrays this is not
+    // reset between searches.
+    int prev[GXM][GYM];
+
+private:
+    static int _index(const coord_def &p)
+    {
+        return p.x * GYM + p.y;
+    }
+
+    void _touch(int i)
+    {
+        if (cell_gen[i] != generation)
+        {
+            cell_gen[i] = generation;
+            queued[i] = false;
+        }
+    }
+
+    uint32_t cell_gen[PF_CELLS];
+    int dist[PF_CELLS];
+    bool queued[PF_CELLS];
+    int link_next[PF_CELLS];
+    int link_prev[PF_CELLS];
+
+    uint32_t bucket_gen[PF_CELLS];
+    int bucket_head[PF_CELLS];
+};
+
+static vector<unique_ptr<pathfind_context>> free_contexts;
+
+static pathfind_context* _acquire_pathfind_context()
+{
+    if (free_contexts.empty())
+        return new pathfind_context;
+
+    pathfind_context *ctx = free_contexts.back().release();
+    free_contexts.pop_back();
+    return ctx;
+}
+
+static void _release_pathfind_context(pathfind_context *ctx)
+{
+    free_contexts.emplace_back(ctx);
+}
 
 int mons_tracking_range(const monster* mon)
 {
@@ -63,12 +205,13 @@ int mons_tracking_range(const monster* mon)
 monster_pathfind::monster_pathfind()
     : mons(nullptr), start(), target(), pos(), allow_diagonals(true),
       traverse_unmapped(false), range(0), min_length(0), max_length(0),
-      dist(), prev(), hash()
+      ctx(_acquire_pathfind_context())
 {
 }
 
 monster_pathfind::~monster_pathfind()
 {
+    _release_pathfind_context(ctx);
 }
 
 void monster_pathfind::set_range(int r)
@@ -79,7 +222,7 @@ void monster_pathfind::set_range(int r)
 
 coord_def monster_pathfind::next_pos(const coord_def &c) const
 {
-    return c + Compass[prev[c.x][c.y]];
+    return c + Compass[ctx->prev[c.x][c.y]];
 }
 
 // The main method in the monster_pathfind class.
@@ -135,11 +278,8 @@ bool monster_pathfind::start_pathfind(bool msg)
     //       a wall.
 
     max_length = min_length = grid_distance(pos, target);
-    for (int i = 0; i < GXM; i++)
-        for (int j = 0; j < GYM; j++)
-            dist[i][j] = INFINITE_DISTANCE;
-
-    dist[pos.x][pos.y] = 0;
+    ctx->begin();
+    ctx->set_dist(pos, 0);
 
     bool success = false;
     do
@@ -209,8 +349,8 @@ bool monster_pathfind::calc_path_to_neighbours()
         if (range && estimated_cost(npos) > range)
             continue;
 
-        distance = dist[pos.x][pos.y] + travel_cost(npos);
-        old_dist = dist[npos.x][npos.y];
+        distance = ctx->get_dist(pos) + travel_cost(npos);
+        old_dist = ctx->get_dist(npos);
 
         // Also bail out if this would make the path longer than twice the
         // allowed distance from the target. (This factor may need tuning.)
@@ -252,7 +392,7 @@ bool monster_pathfind::calc_path_to_neighbours()
             }
 
             // Update distance start->pos.
-            dist[npos.x][npos.y] = distance;
+            ctx->set_dist(npos, distance);
 
             // Set backtracking information.
             // Converts the Compass direction to its counterpart.
@@ -260,7 +400,7 @@ bool monster_pathfind::calc_path_to_neighbours()
             //      7  .  3   ==>   3  .  7       e.g. (3 + 4) % 8          = 7
             //      6  5  4         2  1  0            (7 + 4) % 8 = 11 % 8 = 3
 
-            prev[npos.x][npos.y] = (dir + 4) % 8;
+            ctx->prev[npos.x][npos.y] = (dir + 4) % 8;
 
             // Are we finished?
             if (npos == target)
@@ -276,22 +416,20 @@ bool monster_pathfind::calc_path_to_neighbours()
 }
 
 // Starting at known min_length (minimum total estimated path distance), check
-// the hash for existing vectors, then pick the last entry of the first vector
+// the hash for non-empty buckets, then pick the last entry of the first bucket
 // that matches. Update min_length, if necessary.
 bool monster_pathfind::get_best_position()
 {
     for (int i = min_length; i <= max_length; i++)
     {
-        if (!hash[i].empty())
+        if (!ctx->bucket_empty(i))
         {
             if (i > min_length)
                 min_length = i;
 
-            vector<coord_def> &vec = hash[i];
-            // Pick the last position pushed into the vector as it's most
+            // Pick the last position pushed into the bucket as it's most
             // likely to be close to the target.
-            pos = vec[vec.size()-1];
-            vec.pop_back();
+            pos = ctx->pop(i);
 
 #ifdef DEBUG_PATHFIND
             mprf("Returning (%d, %d) as best pos with total dist %d.",
@@ -326,7 +464,7 @@ vector<coord_def> monster_pathfind::backtrack()
     int dir;
     do
     {
-        dir = prev[pos.x][pos.y];
+        dir = ctx->prev[pos.x][pos.y];
         pos = pos + Compass[dir];
         ASSERT_IN_BOUNDS(pos);
 #ifdef DEBUG_PATHFIND
@@ -491,24 +629,16 @@ int monster_pathfind::estimated_cost(coord_def p)
 
 void monster_pathfind::add_new_pos(coord_def npos, int total)
 {
-    hash[total].push_back(npos);
+    ctx->push(npos, total);
 }
 
 void monster_pathfind::update_pos(coord_def npos, int total)
 {
     // Find hash position of old distance and delete it,
     // then call_add_new_pos.
-    int old_total = dist[npos.x][npos.y] + estimated_cost(npos);
+    int old_total = ctx->get_dist(npos) + estimated_cost(npos);
 
-    vector<coord_def> &vec = hash[old_total];
-    for (unsigned int i = 0; i < vec.size(); i++)
-    {
-        if (vec[i] == npos)
-        {
-            vec.erase(vec.begin() + i);
-            break;
-        }
-    }
+    ctx->remove(npos, old_total);
 
     add_new_pos(npos, total);
 }
@@ -2,12 +2,12 @@
 
 #include "coord-def.h"
 #include "defines.h"
-#include "fixedvector.h"
 #include <vector>
 
 using std::vector;
 
 class monster;
+struct pathfind_context;
 
 int mons_tracking_range(const monster* mon);
 
@@ -16,6 +16,8 @@ class monster_pathfind
 public:
     monster_pathfind();
     virtual ~monster_pathfind();
+    monster_pathfind(const monster_pathfind&) = delete;
+    monster_pathfind& operator=(const monster_pathfind&) = delete;
 
     // public methods
     void set_range(int r);
@@ -66,10 +68,7 @@ protected:
     int min_length;
     int max_length;
 
-    // The array of distances from start to any already tried point.
-    int dist[GXM][GYM];
-    // An array to store where we came from on a given shortest path.
-    int prev[GXM][GYM];
-
-    FixedVector<vector<coord_def>, GXM * GYM> hash;
+    // Distances, backtracking information and the open list, borrowed
+    // from a pool so that repeated searches don't allocate or clear them.
+    pathfind_context *ctx;
 };
@@ -57,19 +57,42 @@ monster_type pick_monster_by_hash(branch_type branch, uint32_t hash)
     return population[branch].pop[hash % population[branch].count].value;
 }
 
+// The main population of a branch at the given depth. These never change,
+// so each is only worked out the first time it's needed; vetoes, which can
+// depend on the game state, are still applied at each pick.
+static const random_pick_table<monster_type> &_population_at(branch_type br,
+                                                             int depth)
+{
+    static map<level_id, random_pick_table<monster_type>> tables;
+
+    const level_id place(br, depth);
+    auto it = tables.find(place);
+    if (it == tables.end())
+    {
+        it = tables.emplace(place, random_pick_table<monster_type>()).first;
+        monster_picker().tabulate(population[br].pop, depth, it->second);
+    }
+    return it->second;
+}
+
 monster_type pick_monster(level_id place, mon_pick_vetoer veto)
 {
 #ifdef ASSERTS
     if (!place.is_valid())
         die("trying to pick a monster from %s", place.describe().c_str());
 #endif
-    return pick_monster_from(population[place.branch].pop, place.depth, veto);
+    monster_picker picker = monster_picker();
+    const auto &table = _population_at(place.branch, place.depth);
+    if (!veto)
+        return picker.pick_unvetoed(table, MONS_0);
+    return picker.pick_with_veto(table, MONS_0, veto);
 }
 
 monster_type pick_monster(level_id place, monster_picker &picker, mon_pick_vetoer veto)
 {
     ASSERT(place.is_valid());
-    return picker.pick_with_veto(population[place.branch].pop, place.depth, MONS_0, veto);
+    return picker.pick_with_veto(_population_at(place.branch, place.depth),
+                                 MONS_0, veto);
 }
 
 monster_type pick_monster_from(const pop_entry *fpop, int depth,
@@ -89,6 +112,14 @@ monster_type monster_picker::pick_with_veto(const pop_entry *weights,
     return pick(weights, level, none);
 }
 
+monster_type monster_picker::pick_with_veto(
+    const random_pick_table<monster_type> &table, monster_type none,
+    mon_pick_vetoer vetoer)
+{
+    _veto = vetoer;
+    return pick(table, none);
+}
+
 // Veto specialisation for the monster_picker class; this simply calls the
 // stored veto function. Can subclass further for more complex veto behaviour.
 bool monster_picker::veto(monster_type mon)
@@ -131,20 +162,16 @@ monster_type pick_monster_all_branches(int absdepth0, monster_picker &picker,
         if (depth < 1 || depth > branch_ood_cap(it->id))
             continue;
 
-        for (const pop_entry *pop = population[it->id].pop; pop->value; pop++)
+        const auto &table = _population_at(it->id, depth);
+        for (int i = 0, size = table.values.size(); i < size; i++)
         {
-            if (depth < pop->minr || depth > pop->maxr)
+            const monster_type mons = table.values[i];
+            if (veto ? (*veto)(mons) : picker.veto(mons))
                 continue;
 
-            if (veto ? (*veto)(pop->value) : picker.veto(pop->value))
-                continue;
-
-            int rar = picker.rarity_at(pop, depth);
-            ASSERT(rar > 0);
-
-            monster_type mons = pop->value;
+            const int rar = table.rarity(i);
             if (!rarities[mons])
-                valid[nvalid++] = pop->value;
+                valid[nvalid++] = mons;
             if (rarities[mons] < rar)
                 rarities[mons] = rar;
         }
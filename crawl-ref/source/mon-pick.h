@@ -43,6 +43,9 @@ public:
     monster_type pick_with_veto(const pop_entry *weights, int level,
                                 monster_type none,
                                 mon_pick_vetoer vetoer = nullptr);
+    monster_type pick_with_veto(const random_pick_table<monster_type> &table,
+                                monster_type none,
+                                mon_pick_vetoer vetoer = nullptr);
 
     virtual bool veto(monster_type mon) override;
 
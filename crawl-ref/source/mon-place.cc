@@ -24,6 +24,7 @@
 #include "env.h"
 #include "errors.h"
 #include "fprop.h"
+#include "free-slots.h"
 #include "gender-type.h"
 #include "ghost.h"
 #include "god-abil.h"
@@ -848,16 +849,37 @@ monster* place_monster(mgen_data mg, bool force_pos, bool dont_place)
     return mon;
 }
 
+static free_slot_cache<MAX_MONSTERS> free_monster_slots;
+
+// Returns an unused env.mons slot, or nullptr if there are none. Like
+// get_mitm_slot(), this is the lowest unused slot during level generation,
+// and a cached one otherwise.
 monster* get_free_monster()
 {
-    for (auto &mons : menv_real)
-        if (mons.type == MONS_NO_MONSTER)
-        {
-            mons.reset();
-            return &mons;
-        }
+    const auto is_free = [](int i) { return env.mons[i].type == MONS_NO_MONSTER; };
+    int slot = crawl_state.generating_level
+               ? -1 : free_monster_slots.take(MAX_MONSTERS, is_free);
+
+    if (slot < 0)
+    {
+        for (slot = 0; slot < MAX_MONSTERS; slot++)
+            if (is_free(slot))
+                break;
+        if (slot >= MAX_MONSTERS)
+            return nullptr;
+    }
 
-    return nullptr;
+    monster &mons = env.mons[slot];
+    mons.reset();
+    env.mons_used = max(env.mons_used, slot + 1);
+    return &mons;
+}
+
+// The cached slots belong to the previous level; rescan so that the next
+// one's monsters start from the bottom again.
+void forget_free_monster_slots()
+{
+    free_monster_slots.clear();
 }
 
 void mons_add_blame(monster* mon, const string &blame_string)
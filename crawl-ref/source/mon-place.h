@@ -123,6 +123,7 @@ void set_vault_mon_list(const vector<mons_spec> &list);
 void setup_vault_mon_list();
 
 monster* get_free_monster();
+void forget_free_monster_slots();
 
 void mons_add_blame(monster* mon, const string &blame_string);
 
@@ -5135,6 +5135,8 @@ void reset_all_monsters()
         }
         mons.reset();
     }
+    env.mons_used = 0;
+    forget_free_monster_slots();
 
     env.mid_cache.clear();
 }
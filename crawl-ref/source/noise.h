@@ -4,6 +4,8 @@
 
 #include <vector>
 
+#include "bitary.h"
+
 using std::vector;
 
 // [ds] The old noise system was pretty simple: noise level (loudness) ==
@@ -110,6 +112,10 @@ public:
     // propagate until propagate_noise() is called.
     void register_noise(const noise_t &noise);
 
+    // Move the noises registered on another grid to this one, so that
+    // they can be propagated while new noises are registered there.
+    void take_noises(noise_grid &other);
+
     // Propagate noise from the noise sources registered.
     void propagate_noise();
 
@@ -138,8 +144,27 @@ private:
                                        const coord_def &affected_position,
                                        const noise_t &noise) const;
 
+    int attenuation_millis(const coord_def &pos);
+
 private:
     FixedArray<noise_cell, GXM, GYM> cells;
     vector<noise_t> noises;
     int affected_actor_count;
+
+    // The cells that have been given a noise since the last reset(), so
+    // that only those need clearing.
+    vector<coord_def> touched;
+
+    // The current and next frontier of propagate_noise(), kept between
+    // calls so that their storage is reused.
+    vector<coord_def> perimeter[2];
+
+    // The cells holding an actor when propagation started; noise only
+    // needs applying there.
+    FixedBitArray<GXM, GYM> actor_cells;
+
+    // The attenuation of each cell, and the feature it was worked out for,
+    // so that it is only redone where the terrain has changed.
+    FixedArray<int, GXM, GYM> attenuation_cache;
+    FixedArray<dungeon_feature_type, GXM, GYM> attenuation_feat;
 };
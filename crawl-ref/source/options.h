@@ -174,6 +174,7 @@ public:
                                 // are stored. On a multi-user system, this dir
                                 // should be accessible by different people.
     vector<string> additional_macro_files;
+    bool        save_level_deltas; // Save levels as changes to a base copy.
 
     uint64_t    seed;           // Non-random games.
     uint64_t    seed_from_rc;
@@ -401,6 +402,9 @@ public:
     string sound_file_path;
     vector<colour_mapping> menu_colour_mappings;
     vector<message_colour_mapping> message_colour_mappings;
+    // Changes whenever force_more_message, flash_screen_message or
+    // message_colour_mappings do, so message.cc knows to recompile them.
+    unsigned int message_filter_generation;
 
     vector<menu_sort_condition> sort_menus;
 
@@ -632,6 +636,7 @@ private:
     void add_message_colour_mappings(const string &, bool, bool);
     void add_message_colour_mapping(const string &, bool, bool);
     message_filter parse_message_filter(const string &s);
+    void message_filters_changed();
 
     void set_default_activity_interrupts();
     void set_activity_interrupt(FixedBitVector<NUM_ACTIVITY_INTERRUPTS> &eints,
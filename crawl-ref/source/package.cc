@@ -86,6 +86,10 @@ package::package(const char* file, bool writeable, bool empty)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
+#ifdef ASYNC_COMMIT
+    , committing(false), commit_start(0), commit_error(nullptr),
+    commit_errno(0)
+#endif
 {
     dprintf("package: initializing file=\"%s\" rw=%d\n", file, writeable);
     ASSERT(writeable || !empty);
@@ -136,6 +140,10 @@ package::package()
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
+#ifdef ASYNC_COMMIT
+    , committing(false), commit_start(0), commit_error(nullptr),
+    commit_errno(0)
+#endif
 {
     dprintf("package: initializing tmp file\n");
     filename = "[tmp]";
@@ -217,9 +225,13 @@ package::~package()
     if (rw && !aborted)
     {
         commit();
+#ifdef ASYNC_COMMIT
+        finish_commit();
+#endif
         if (ftruncate(fd, file_len))
             sysfail("failed to update save file");
     }
+    await_commit();
 
     // all errors here should be cached write errors
     if (fd != -1)
@@ -238,34 +250,108 @@ void package::commit()
         return;
     ASSERT(!aborted);
 
+#ifdef ASYNC_COMMIT
+    // Only one commit may be in flight, and the blocks the last one freed
+    // can be reused now.
+    finish_commit();
+#endif
+
+#ifdef COSTLY_ASSERTS
+    fsck();
+#endif
+
+    const plen_t start = write_directory();
+    new_chunks.clear();
+    dirty = false;
+
+#ifdef ASYNC_COMMIT
+    // Blocks unlinked by this commit stay allocated until its header is on
+    // disk: until then, a crash leaves the previous directory in effect.
+    commit_start = start;
+    commit_unlinked.swap(unlinked_blocks);
+    committing = true;
+    if (!thread_create_joinable(&commit_thread, commit_thread_main, this))
+        return;
+
+    // No thread, so finish the commit here.
+    committing = false;
+    unlinked_blocks.swap(commit_unlinked);
+#endif
+
+    if (const char *error = write_header(start))
+        sysfail("%s", error);
+    collect_blocks();
+
 #ifdef COSTLY_ASSERTS
     fsck();
 #endif
+}
 
+// Point the header at the directory at `start`. Returns an error message
+// (with errno set) on failure. This doesn't touch anything but the file, so
+// it may run outside the main thread.
+const char *package::write_header(plen_t start)
+{
     file_header head;
     head.magic = htole(PACKAGE_MAGIC);
     head.version = PACKAGE_VERSION;
     memset(&head.padding, 0, sizeof(head.padding));
-    head.start = htole(write_directory());
+    head.start = htole(start);
 #ifdef DO_FSYNC
     // We need a barrier before updating the link to point at the new directory.
     if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+        return "flush error while saving";
 #endif
+#ifdef ASYNC_COMMIT
+    // pwrite(), as the main thread may be seeking around the file meanwhile.
+    if (pwrite(fd, &head, sizeof(head), 0) != sizeof(head))
+#else
     seek(0);
     if (write(fd, &head, sizeof(head)) != sizeof(head))
-        sysfail("write error while saving");
+#endif
+        return "write error while saving";
 #ifdef DO_FSYNC
     if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+        return "flush error while saving";
 #endif
+    return nullptr;
+}
 
-    new_chunks.clear();
-    collect_blocks();
-    dirty = false;
+#ifdef ASYNC_COMMIT
+void *package::commit_thread_main(void *pkg)
+{
+    package *save = static_cast<package *>(pkg);
+    save->commit_error = save->write_header(save->commit_start);
+    save->commit_errno = save->commit_error ? errno : 0;
+    return nullptr;
+}
 
-#ifdef COSTLY_ASSERTS
-    fsck();
+// Wait for the commit in flight, then free the blocks it unlinked.
+void package::finish_commit()
+{
+    await_commit();
+    if (const char *error = commit_error)
+    {
+        commit_error = nullptr;
+        errno = commit_errno;
+        sysfail("%s", error);
+    }
+
+    for (plen_t at : commit_unlinked)
+        free_block_chain(at);
+    commit_unlinked.clear();
+}
+#endif
+
+// Block until the last commit has reached the disk. Safe to call from the
+// crash handler: it only waits, and leaves the bookkeeping for later.
+void package::await_commit()
+{
+#ifdef ASYNC_COMMIT
+    if (!committing)
+        return;
+    thread_join(commit_thread);
+    committing = false;
 #endif
 }
 
@@ -625,6 +711,7 @@ void package::abort()
 void package::unlink()
 {
     abort();
+    await_commit();
     close(fd);
     fd = -1;
     ::unlink_u(filename.c_str());
@@ -777,6 +864,11 @@ void chunk_writer::finish_block(plen_t next)
     pkg->block_map[cur_block] = bm_p(block_len, next);
 }
 
+bool chunk_writer::aborted() const
+{
+    return pkg->aborted;
+}
+
 void chunk_writer::write(const void *data, plen_t len)
 {
     ASSERT(data);
@@ -20,6 +20,18 @@ using std::vector;
 #define DO_FSYNC
 #endif
 
+// With ASYNC_COMMIT, commit() writes the directory and then leaves the
+// header update and its fsyncs to a background thread, so the game doesn't
+// wait for the disk. Blocks freed by a commit aren't reused until its header
+// is on disk, so the crash guarantees below still hold.
+#if defined(ASYNC_COMMIT) && defined(TARGET_OS_WINDOWS)
+#undef ASYNC_COMMIT
+#endif
+
+#ifdef ASYNC_COMMIT
+#include "threads.h"
+#endif
+
 #define MAX_CHUNK_NAME_LENGTH 255
 
 typedef uint32_t plen_t;
@@ -44,6 +56,7 @@ public:
     chunk_writer(package *parent, const string &_name);
     ~chunk_writer();
     void write(const void *data, plen_t len);
+    bool aborted() const;
     friend class package;
 };
 
@@ -78,6 +91,7 @@ public:
     chunk_writer* writer(const string &name);
     chunk_reader* reader(const string &name);
     void commit();
+    void await_commit();
     void delete_chunk(const string &name);
     bool has_chunk(const string &name);
     vector<string> list_chunks();
@@ -106,6 +120,17 @@ private:
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+#ifdef ASYNC_COMMIT
+    thread_t commit_thread;
+    bool committing;
+    plen_t commit_start;
+    const char *commit_error;
+    int commit_errno;
+    vector<plen_t> commit_unlinked;
+    static void *commit_thread_main(void *pkg);
+    void finish_commit();
+#endif
+    const char *write_header(plen_t start);
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
     void finish_chunk(const string &name, plen_t at);
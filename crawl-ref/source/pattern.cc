@@ -229,3 +229,113 @@ pattern_match plaintext_pattern::match_location(const string &s) const
     else
         return pattern_match::failed(s);
 }
+
+/**
+ * Collect the literal strings that any match of a regex must contain.
+ *
+ * Only runs of at least three printable ASCII characters are kept, lowercased,
+ * which is what prefilters based on trigrams can use. This is deliberately
+ * conservative: anything that might make a character optional ends the run.
+ *
+ * @param regex      The pattern, in text_pattern syntax.
+ * @param[out] runs  The literal runs found.
+ * @return false if the pattern has alternations or groups, and so might
+ *         not require any of its literals, or uses escapes that the regex
+ *         engines read differently.
+ */
+bool regex_literals(const string &regex, vector<string> &runs)
+{
+    string run;
+    auto end_run = [&]()
+    {
+        if (run.size() >= 3)
+            runs.push_back(run);
+        run.clear();
+    };
+
+    for (size_t i = 0; i < regex.size(); ++i)
+    {
+        char c = regex[i];
+        switch (c)
+        {
+        case '|': case '(': case ')':
+            return false;
+
+        case '{':
+            i = regex.find('}', i);
+            if (i == string::npos)
+                return false;
+            // fallthrough
+        case '?': case '*':
+            // The character before may not appear at all.
+            if (!run.empty())
+                run.pop_back();
+            end_run();
+            break;
+
+        case '[':
+        {
+            end_run();
+            size_t j = i + 1;
+            if (j < regex.size() && regex[j] == '^')
+                ++j;
+            // A ']' straight after the (possibly negated) opening bracket
+            // is part of the class.
+            if (j < regex.size() && regex[j] == ']')
+                ++j;
+            for (; j < regex.size() && regex[j] != ']'; ++j)
+            {
+                // [:alpha:], [.x.] and [=x=] have ']'s of their own.
+                if (regex[j] == '[' && j + 1 < regex.size()
+                    && (regex[j + 1] == ':' || regex[j + 1] == '.'
+                        || regex[j + 1] == '='))
+                {
+                    const char close[] = { regex[j + 1], ']', 0 };
+                    j = regex.find(close, j + 2);
+                    if (j == string::npos)
+                        return false;
+                    ++j;
+                }
+            }
+            if (j >= regex.size())
+                return false;
+            i = j;
+            break;
+        }
+
+        case '\\':
+            // \Q...\E quotes and \x41 escapes are literals under PCRE but
+            // not POSIX, so leave those patterns to a full scan.
+            if (i + 1 < regex.size()
+                && (regex[i + 1] == 'Q' || regex[i + 1] == 'x'))
+            {
+                return false;
+            }
+            // Only these escapes are literal to both engines; glibc reads
+            // \< and \> as word boundaries, and letters and digits are
+            // classes, anchors or backreferences.
+            if (i + 1 < regex.size() && regex[i + 1]
+                && strchr(".[]()*+?{}|^$\\/", regex[i + 1]))
+            {
+                run += regex[++i];
+                break;
+            }
+            end_run();
+            ++i;
+            break;
+
+        case '+': case '.': case '^': case '$':
+            end_run();
+            break;
+
+        default:
+            if (c >= ' ' && c <= '~')
+                run += tolower(c);
+            else
+                end_run();
+            break;
+        }
+    }
+    end_run();
+    return true;
+}
@@ -154,3 +154,5 @@ private:
     string pattern;
     bool ignore_case;
 };
+
+bool regex_literals(const string &regex, vector<string> &runs);
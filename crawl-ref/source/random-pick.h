@@ -5,8 +5,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "random.h"
 
+using std::vector;
+
 enum distrib_type
 {
     FLAT, // full chance throughout the range
@@ -27,12 +32,30 @@ struct random_pick_entry
     T value;
 };
 
+// The entries of a weights list that can appear at one level, with their
+// rarities there worked out, for lists that are picked from over and over.
+template <typename T>
+struct random_pick_table
+{
+    vector<T> values;
+    vector<int> cumulative; // running total of the rarities
+
+    int rarity(int i) const
+    {
+        return cumulative[i] - (i ? cumulative[i - 1] : 0);
+    }
+};
+
 template <typename T, int max>
 class random_picker
 {
 public:
     virtual ~random_picker();
     T pick(const random_pick_entry<T> *weights, int level, T none);
+    T pick(const random_pick_table<T> &table, T none);
+    T pick_unvetoed(const random_pick_table<T> &table, T none);
+    void tabulate(const random_pick_entry<T> *weights, int level,
+                  random_pick_table<T> &table);
     int probability_at(T entry, const random_pick_entry<T> *weights, int level);
     int rarity_at(const random_pick_entry<T> *pop,
                   int depth);
@@ -81,6 +104,74 @@ T random_picker<T, max>::pick(const random_pick_entry<T> *weights, int level,
     die("random_pick roll out of range");
 }
 
+// Picks exactly as pick() would from the weights the table was made from,
+// with the same vetoes made and the same random number used.
+template <typename T, int max>
+T random_picker<T, max>::pick(const random_pick_table<T> &table, T none)
+{
+    struct { T value; int rarity; } valid[max];
+    int nvalid = 0;
+    int totalrar = 0;
+
+    for (int i = 0, size = table.values.size(); i < size; i++)
+    {
+        if (veto(table.values[i]))
+            continue;
+
+        valid[nvalid].value = table.values[i];
+        valid[nvalid].rarity = table.rarity(i);
+        totalrar += valid[nvalid].rarity;
+        nvalid++;
+    }
+
+    if (!nvalid)
+        return none;
+
+    totalrar = random2(totalrar); // the roll!
+
+    for (int i = 0; i < nvalid; i++)
+        if ((totalrar -= valid[i].rarity) < 0)
+            return valid[i].value;
+
+    die("random_pick roll out of range");
+}
+
+// As pick(), but without asking veto(): a binary search of the table.
+template <typename T, int max>
+T random_picker<T, max>::pick_unvetoed(const random_pick_table<T> &table,
+                                       T none)
+{
+    if (table.values.empty())
+        return none;
+
+    const int roll = random2(table.cumulative.back());
+    const auto it = upper_bound(table.cumulative.begin(),
+                                table.cumulative.end(), roll);
+    return table.values[it - table.cumulative.begin()];
+}
+
+template <typename T, int max>
+void random_picker<T, max>::tabulate(const random_pick_entry<T> *weights,
+                                     int level, random_pick_table<T> &table)
+{
+    table.values.clear();
+    table.cumulative.clear();
+    int totalrar = 0;
+
+    for (const random_pick_entry<T> *pop = weights; pop->rarity; pop++)
+    {
+        if (level < pop->minr || level > pop->maxr)
+            continue;
+
+        int rar = rarity_at(pop, level);
+        ASSERTM(rar > 0, "Rarity %d: %d at level %d", rar, pop->value, level);
+
+        totalrar += rar;
+        table.values.push_back(pop->value);
+        table.cumulative.push_back(totalrar);
+    }
+}
+
 template <typename T, int max>
 int random_picker<T, max>::probability_at(T entry,
                     const random_pick_entry<T> *weights, int level)
@@ -0,0 +1,76 @@
+-- Benchmark for travel and explore pathfinding.
+--
+-- Generates each given level from a fixed seed, explores it with the wizard
+-- mode explore test (no monsters, traps or doors), and reports pathfinds
+-- per second, how many of them flooded from scratch, how many distance
+-- fields answered instead, and how many squares those fields settled.
+--
+--   util/fake_pty ./crawl -script explore_bench.lua [-seed <n>] [-nofields]
+--                                                    [<place> ...]
+--
+-- Places default to D:1 through D:8. With -nofields, every pathfind floods
+-- from scratch, for comparison.
+
+local seed = 1
+local fields = true
+local places = { }
+local usage = "Usage: explore_bench.lua [-seed <n>] [-nofields] [<place> ...]"
+
+local args = crawl.script_args()
+local i = 1
+while i <= #args do
+  if args[i] == "-seed" then
+    seed = tonumber(args[i + 1])
+    if not seed then
+      script.usage(usage)
+    end
+    i = i + 1
+  elseif args[i] == "-nofields" then
+    fields = false
+  else
+    table.insert(places, args[i])
+  end
+  i = i + 1
+end
+
+if #places == 0 then
+  for depth = 1, 8 do
+    table.insert(places, "D:" .. depth)
+  end
+end
+
+debug.disable("confirmations")
+-- Don't time the pause between travel steps.
+crawl.setopt("travel_delay = -1")
+debug.travel_distance_fields(fields)
+
+local format = "%-8s %6d pathfinds %6d floods %6d answered %8d settled"
+               .. " %6d ms %10.1f pathfinds/s"
+local total_ms, total_pathfinds, total_floods = 0, 0, 0
+local total_answers, total_settled = 0, 0
+for _, place in ipairs(places) do
+  debug.reset_rng(seed)
+  test.regenerate_level(place)
+  local start = test.find_feature("stone_stairs_up_i")
+                or test.find_feature("exit_dungeon")
+  you.moveto(start.x, start.y)
+  debug.travel_flood_stats(true)
+
+  local t0 = crawl.millis()
+  debug.test_explore()
+  local elapsed = crawl.millis() - t0
+
+  local pathfinds, floods, answers, settled = debug.travel_flood_stats()
+  crawl.stderr(string.format(format, place, pathfinds, floods, answers,
+                             settled, elapsed,
+                             pathfinds * 1000 / math.max(elapsed, 1)))
+  total_ms = total_ms + elapsed
+  total_pathfinds = total_pathfinds + pathfinds
+  total_floods = total_floods + floods
+  total_answers = total_answers + answers
+  total_settled = total_settled + settled
+end
+
+crawl.stderr(string.format(format, "total", total_pathfinds, total_floods,
+                           total_answers, total_settled, total_ms,
+                           total_pathfinds * 1000 / math.max(total_ms, 1)))
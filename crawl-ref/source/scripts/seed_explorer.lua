@@ -25,12 +25,16 @@ crawl_require('dlua/explorer.lua')
 -- (This will need to generate all of D before getting to the temple, so is
 -- somewhat slow.)
 --
+-- time level generation for a seed, per branch (this is the same serial
+-- builder that `pregen_dungeon = full` runs at game start):
+--   util/fake_pty ./crawl -script seed_explorer.lua -seed 1 -depth all -cats vaults -time
+--
 -- When running scripts with fake_pty, all output goes to stderr, so to
 -- redirect this to a file you will need to do something like:
 --   util/fake_pty ./crawl -script seed_explorer.lua -seed 1 > out.txt 2>&1
 
 local basic_usage = [=[
-Usage: seed_explorer.lua -seed <seed> ([<seed> ...]|[-count <n>]) ([-depth <depth>]|[-show <lvl> [<lvl> ...]]) [-cats <cat> [<cat ...]] [-artefacts] [-mon-items]
+Usage: seed_explorer.lua -seed <seed> ([<seed> ...]|[-count <n>]) ([-depth <depth>]|[-show <lvl> [<lvl> ...]]) [-cats <cat> [<cat ...]] [-artefacts] [-mon-items] [-time]
     <seed>:   either a number, or 'random'. Random values are 32 bits only.
     <n>:      a number of times to iterate from <seed>. If seed is a number, this
               will count up; if it is 'random' it will choose n random seeds.
@@ -52,7 +56,9 @@ Usage: seed_explorer.lua -seed <seed> ([<seed> ...]|[-count <n>]) ([-depth <dept
         -mon-items: show only monsters with items (monsters).
         -shops:     show only shops (items, features).
         -all-mons:  show all monsters (monsters).
-        -all-items: show all items on ground (items).]]
+        -all-items: show all items on ground (items).
+    Other flags:
+        -time:      report wall-clock level generation time per branch.]]
 
 function parse_args(args, err_fun)
     accum_init = { }
@@ -200,6 +206,7 @@ if mon_items_only then
         end
 end
 if all_mons then explorer.mons_notable = function (x) return true end end
+explorer.show_times = (args["-time"] ~= nil)
 
 explorer.catalog_seeds(seed_seq, max_depth, categories, show_level_fun)
 explorer.reset_to_defaults()
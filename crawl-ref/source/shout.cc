@@ -762,16 +762,15 @@ void yell(const actor* mon)
 
 void apply_noises()
 {
-    // [ds] This copying isn't awesome, but we cannot otherwise handle
-    // the case where one set of noises wakes up monsters who then let
-    // out yips of their own, modifying _noise_grid while it is in the
-    // middle of propagate_noise().
+    // Noises are propagated on a second grid, since one set of noises may
+    // wake up monsters who then let out yips of their own, modifying
+    // _noise_grid while it is in the middle of propagate_noise().
     if (_noise_grid.dirty())
     {
-        noise_grid copy = _noise_grid;
-        // Reset the main grid.
-        _noise_grid.reset();
-        copy.propagate_noise();
+        static noise_grid propagating;
+        propagating.take_noises(_noise_grid);
+        propagating.propagate_noise();
+        propagating.reset();
     }
 }
 
@@ -912,20 +911,51 @@ int noise_cell::turn_angle(const coord_def &next_delta) const
 noise_grid::noise_grid()
     : cells(), noises(), affected_actor_count(0)
 {
+    attenuation_feat.init(NUM_FEATURES);
 }
 
 void noise_grid::reset()
 {
-    cells.init(noise_cell());
+    for (const coord_def &p : touched)
+        cells(p) = noise_cell();
+    touched.clear();
     noises.clear();
     affected_actor_count = 0;
 }
 
+void noise_grid::take_noises(noise_grid &other)
+{
+    reset();
+    noises.swap(other.noises);
+    // Only the sources have been given any noise yet.
+    for (const noise_t &noise : noises)
+    {
+        const coord_def &p = noise.noise_source;
+        if (cells(p).silent())
+            touched.push_back(p);
+        cells(p) = other.cells(p);
+    }
+    other.reset();
+}
+
+int noise_grid::attenuation_millis(const coord_def &pos)
+{
+    const dungeon_feature_type feat = env.grid(pos);
+    if (attenuation_feat(pos) != feat)
+    {
+        attenuation_feat(pos) = feat;
+        attenuation_cache(pos) = _noise_attenuation_millis(pos);
+    }
+    return attenuation_cache(pos);
+}
+
 void noise_grid::register_noise(const noise_t &noise)
 {
     noise_cell &target_cell(cells(noise.noise_source));
     if (target_cell.can_apply_noise(noise.noise_intensity_millis))
     {
+        if (target_cell.silent())
+            touched.push_back(noise.noise_source);
         const int noise_index = noises.size();
         noises.push_back(noise);
         noises[noise_index].noise_id = noise_index;
@@ -945,29 +975,38 @@ void noise_grid::propagate_noise()
     dprf(DIAG_NOISE, "noise_grid: %u noises to apply",
          (unsigned int)noises.size());
 #endif
-    vector<coord_def> noise_perimeter[2];
+    actor_cells.reset();
+    for (actor_near_iterator ai(you.pos(), LOS_NONE); ai; ++ai)
+        if (map_bounds(ai->pos()))
+            actor_cells.set(ai->pos());
+
     int circ_index = 0;
+    perimeter[0].clear();
+    perimeter[1].clear();
 
     for (const noise_t &noise : noises)
-        noise_perimeter[circ_index].push_back(noise.noise_source);
+        perimeter[circ_index].push_back(noise.noise_source);
 
     int travel_distance = 0;
-    while (!noise_perimeter[circ_index].empty())
+    while (!perimeter[circ_index].empty())
     {
-        const vector<coord_def> &perimeter(noise_perimeter[circ_index]);
-        vector<coord_def> &next_perimeter(noise_perimeter[!circ_index]);
+        const vector<coord_def> &current(perimeter[circ_index]);
+        vector<coord_def> &next_perimeter(perimeter[!circ_index]);
         ++travel_distance;
-        for (const coord_def &p : perimeter)
+        for (const coord_def &p : current)
         {
             const noise_cell &cell(cells(p));
 
             if (!cell.silent())
             {
-                apply_noise_effects(p,
-                                    cell.noise_intensity_millis,
-                                    noises[cell.noise_id]);
+                if (actor_cells(p))
+                {
+                    apply_noise_effects(p,
+                                        cell.noise_intensity_millis,
+                                        noises[cell.noise_id]);
+                }
 
-                const int attenuation = _noise_attenuation_millis(p);
+                const int attenuation = attenuation_millis(p);
                 // If the base noise attenuation kills the noise, go no farther:
                 if (noise_is_audible(cell.noise_intensity_millis - attenuation))
                 {
@@ -1000,7 +1039,7 @@ void noise_grid::propagate_noise()
             }
         }
 
-        noise_perimeter[circ_index].clear();
+        perimeter[circ_index].clear();
         circ_index = !circ_index;
     }
 
@@ -1037,6 +1076,8 @@ bool noise_grid::propagate_noise_to_neighbour(int base_attenuation,
     if (noise_is_audible(attenuated_noise_intensity))
     {
         const int neighbour_old_distance = neighbour.noise_travel_distance;
+        if (neighbour.silent())
+            touched.push_back(next_pos);
         if (neighbour.apply_noise(attenuated_noise_intensity,
                                   cell.noise_id,
                                   travel_distance,
@@ -723,6 +723,21 @@ bool LevelStashes::needs_visit(const coord_def& c, bool autopickup) const
     return shop_needs_visit(c);
 }
 
+vector<coord_def> LevelStashes::squares_needing_visit(bool autopickup) const
+{
+    vector<coord_def> squares;
+    for (const auto &entry : m_stashes)
+        if (needs_visit(entry.first, autopickup))
+            squares.push_back(entry.first);
+
+    // Shops sharing a square with a stash were checked above.
+    for (const ShopInfo &shop : m_shops)
+        if (!shop.is_visited() && !find_stash(shop.shop.pos))
+            squares.push_back(shop.shop.pos);
+
+    return squares;
+}
+
 bool LevelStashes::needs_stop(const coord_def &c) const
 {
     const Stash *s = find_stash(c);
@@ -1680,7 +1695,7 @@ bool StashTracker::display_search_results(
             ++hotkey;
     }
 
-    stashmenu.set_flags(MF_SINGLESELECT | MF_ALLOW_FORMATTING);
+    stashmenu.set_flags(MF_SINGLESELECT | MF_ALLOW_FORMATTING | MF_VIRTUALIZE);
 
     stashmenu.on_single_selection = [&stashmenu, &search, &nohl](const MenuEntry& item)
     {
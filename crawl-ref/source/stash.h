@@ -194,6 +194,9 @@ public:
     bool  needs_visit(const coord_def& c, bool autopickup) const;
     bool  shop_needs_visit(const coord_def& c) const;
 
+    // All squares for which needs_visit() is true.
+    vector<coord_def> squares_needing_visit(bool autopickup) const;
+
     // Returns true if the items at c are not fully known to the stash-tracker
     // and the items are not all handled by autopickup.
     bool  needs_stop(const coord_def &c) const;
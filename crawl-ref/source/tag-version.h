@@ -255,6 +255,7 @@ enum tag_minor_version
     TAG_MINOR_REALLY_UNSTACK_EVOKERS, // Unstack all evokers
     TAG_MINOR_SETPOLY,             // Despoiler polymorph wands
     TAG_MINOR_GOLDIFY_MANUALS,     // Move manuals out of the inventory
+    TAG_MINOR_LEVEL_DELTAS,        // Levels may be saved as a base and delta
 #endif
     NUM_TAG_MINORS,
     TAG_MINOR_VERSION = NUM_TAG_MINORS - 1
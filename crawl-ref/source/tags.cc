@@ -109,16 +109,18 @@ extern set<pair<string, level_id> > auto_unique_annotations;
 extern abyss_state abyssal_state;
 
 reader::reader(const string &_read_filename, int minorVersion)
-    : _filename(_read_filename), _chunk(0), _pbuf(nullptr), _read_offset(0),
-      _minorVersion(minorVersion), _safe_read(false)
+    : _filename(_read_filename), _chunk(0), _mem(nullptr), _mem_size(0),
+      _read_offset(0), _minorVersion(minorVersion), _safe_read(false),
+      _buf_pos(0), _buf_len(0)
 {
     _file       = fopen_u(_filename.c_str(), "rb");
     opened_file = !!_file;
 }
 
 reader::reader(package *save, const string &chunkname, int minorVersion)
-    : _file(0), _chunk(0), opened_file(false), _pbuf(0), _read_offset(0),
-     _minorVersion(minorVersion), _safe_read(false)
+    : _file(0), _chunk(0), opened_file(false), _mem(nullptr), _mem_size(0),
+      _read_offset(0), _minorVersion(minorVersion), _safe_read(false),
+      _buf_pos(0), _buf_len(0)
 {
     ASSERT(save);
     _chunk = new chunk_reader(save, chunkname);
@@ -153,7 +155,7 @@ void reader::advance(size_t offset)
 bool reader::valid() const
 {
     return (_file && !feof(_file)) ||
-           (_pbuf && _read_offset < _pbuf->size());
+           (_mem && _read_offset < _mem_size);
 }
 
 static NORETURN void _short_read(bool safe_read)
@@ -165,8 +167,16 @@ static NORETURN void _short_read(bool safe_read)
     die_noline("short read while reading save");
 }
 
+// Refill the read-ahead buffer from the chunk, returning false at its end.
+bool reader::fill_buffer()
+{
+    _buf_pos = 0;
+    _buf_len = _chunk->read(_buf, sizeof(_buf));
+    return _buf_len > 0;
+}
+
 // Reads input in network byte order, from a file or buffer.
-unsigned char reader::readByte()
+unsigned char reader::read_byte_unbuffered()
 {
     if (_file)
     {
@@ -177,20 +187,19 @@ unsigned char reader::readByte()
     }
     else if (_chunk)
     {
-        unsigned char buf;
-        if (_chunk->read(&buf, 1) != 1)
+        if (!fill_buffer())
             _short_read(_safe_read);
-        return buf;
+        return _buf[_buf_pos++];
     }
     else
     {
-        if (_read_offset >= _pbuf->size())
+        if (_read_offset >= _mem_size)
             _short_read(_safe_read);
-        return (*_pbuf)[_read_offset++];
+        return _mem[_read_offset++];
     }
 }
 
-void reader::read(void *data, size_t size)
+void reader::read_unbuffered(void *data, size_t size)
 {
     if (_file)
     {
@@ -204,15 +213,32 @@ void reader::read(void *data, size_t size)
     }
     else if (_chunk)
     {
-        if (_chunk->read(data, size) != size)
-            _short_read(_safe_read);
+        // Use up what has been read ahead first.
+        const size_t avail = _buf_len - _buf_pos;
+        memcpy(data, _buf + _buf_pos, avail);
+        data = (char *)data + avail;
+        size -= avail;
+        _buf_pos = _buf_len;
+
+        if (size >= sizeof(_buf))
+        {
+            if (_chunk->read(data, size) != size)
+                _short_read(_safe_read);
+        }
+        else
+        {
+            if (!fill_buffer() || _buf_len < size)
+                _short_read(_safe_read);
+            memcpy(data, _buf, size);
+            _buf_pos = size;
+        }
     }
     else
     {
-        if (_read_offset+size > _pbuf->size())
+        if (_read_offset+size > _mem_size)
             _short_read(_safe_read);
         if (data && size)
-            memcpy(data, &(*_pbuf)[_read_offset], size);
+            memcpy(data, _mem + _read_offset, size);
 
         _read_offset += size;
     }
@@ -232,9 +258,9 @@ void reader::setMinorVersion(int minorVersion)
 void reader::fail_if_not_eof(const string &name)
 {
     char dummy;
-    if (_chunk ? _chunk->read(&dummy, 1) :
+    if (_chunk ? _buf_pos < _buf_len || _chunk->read(&dummy, 1) :
         _file ? (fgetc(_file) != EOF) :
-        _read_offset >= _pbuf->size())
+        _read_offset >= _mem_size)
     {
         fail("Incomplete read of \"%s\" - aborting.", name.c_str());
     }
@@ -250,26 +276,42 @@ void writer::check_ok(bool ok)
     }
 }
 
-void writer::writeByte(unsigned char ch)
+writer::~writer()
 {
-    if (failed)
-        return;
-
     if (_chunk)
-        _chunk->write(&ch, 1);
-    else if (_file)
-        check_ok(fputc(ch, _file) != EOF);
-    else
-        _pbuf->push_back(ch);
+    {
+        // Nothing more can go into a save that has been given up on.
+        if (!_chunk->aborted())
+            flush();
+        delete _chunk;
+    }
 }
 
-void writer::write(const void *data, size_t size)
+void writer::flush()
+{
+    if (_buf_used)
+    {
+        _chunk->write(_buf, _buf_used);
+        _buf_used = 0;
+    }
+}
+
+void writer::write_unbuffered(const void *data, size_t size)
 {
     if (failed)
         return;
 
     if (_chunk)
-        _chunk->write(data, size);
+    {
+        flush();
+        if (size >= _buf_size)
+            _chunk->write(data, size);
+        else
+        {
+            memcpy(_buf, data, size);
+            _buf_used = size;
+        }
+    }
     else if (_file)
         check_ok(fwrite(data, 1, size, _file) == size);
     else
@@ -374,18 +416,20 @@ void marshallShort(writer &th, short data)
 {
     // TODO: why does this use `short` and `char` when unmarshall uses int16_t??
     CHECK_INITIALIZED(data);
-    const char b2 = (char)(data & 0x00FF);
-    const char b1 = (char)((data & 0xFF00) >> 8);
-    th.writeByte(b1);
-    th.writeByte(b2);
+    const char bytes[2] =
+    {
+        (char)((data & 0xFF00) >> 8),
+        (char)(data & 0x00FF),
+    };
+    th.write(bytes, sizeof(bytes));
 }
 
 // Unmarshall 2 byte short in network order.
 int16_t unmarshallShort(reader &th)
 {
-    int16_t b1 = th.readByte();
-    int16_t b2 = th.readByte();
-    int16_t data = (b1 << 8) | (b2 & 0x00FF);
+    unsigned char bytes[2];
+    th.read(bytes, sizeof(bytes));
+    int16_t data = (bytes[0] << 8) | bytes[1];
     return data;
 }
 
@@ -393,28 +437,23 @@ int16_t unmarshallShort(reader &th)
 void marshallInt(writer &th, int32_t data)
 {
     CHECK_INITIALIZED(data);
-    char b4 = (char) (data & 0x000000FF);
-    char b3 = (char)((data & 0x0000FF00) >> 8);
-    char b2 = (char)((data & 0x00FF0000) >> 16);
-    char b1 = (char)((data & 0xFF000000) >> 24);
-
-    th.writeByte(b1);
-    th.writeByte(b2);
-    th.writeByte(b3);
-    th.writeByte(b4);
+    const char bytes[4] =
+    {
+        (char)((data & 0xFF000000) >> 24),
+        (char)((data & 0x00FF0000) >> 16),
+        (char)((data & 0x0000FF00) >> 8),
+        (char) (data & 0x000000FF),
+    };
+    th.write(bytes, sizeof(bytes));
 }
 
 // Unmarshall 4 byte signed int in network order.
 int32_t unmarshallInt(reader &th)
 {
-    int32_t b1 = th.readByte();
-    int32_t b2 = th.readByte();
-    int32_t b3 = th.readByte();
-    int32_t b4 = th.readByte();
-
-    int32_t data = (b1 << 24) | ((b2 & 0x000000FF) << 16);
-    data |= ((b3 & 0x000000FF) << 8) | (b4 & 0x000000FF);
-    return data;
+    unsigned char bytes[4];
+    th.read(bytes, sizeof(bytes));
+    return (int32_t)((uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16
+                     | (uint32_t)bytes[2] << 8 | bytes[3]);
 }
 
 void marshallUnsigned(writer& th, uint64_t v)
@@ -4537,9 +4576,8 @@ static void _tag_construct_level(writer &th)
 
     // how many clouds?
     marshallShort(th, env.cloud.size());
-    for (const auto& entry : env.cloud)
+    for (const cloud_struct& cloud : env.cloud)
     {
-        const cloud_struct& cloud = entry.second;
         marshallByte(th, cloud.type);
         ASSERT(cloud.type != CLOUD_NONE);
         ASSERT_IN_BOUNDS(cloud.pos);
@@ -6868,6 +6906,7 @@ static void _tag_read_level_monsters(reader &th)
     // how many monsters?
     count = unmarshallShort(th);
     ASSERT_RANGE(count, 0, MAX_MONSTERS + 1);
+    env.mons_used = count;
 
     for (int i = 0; i < count; i++)
     {
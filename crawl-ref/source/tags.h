@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstdio>
+#include <cstring>
 #include <vector>
 
 #include "bitary.h"
@@ -48,36 +49,63 @@ enum tag_type   // used during save/load process to identify data blocks
  * writer API
  * *********************************************************************** */
 
+// Save chunks are compressed as they are written, which is slow a byte at a
+// time, so writers and readers of chunks go through a buffer of this size.
+#define TAG_CHUNK_BUFFER 4096
+
 class writer
 {
 public:
     writer(const string &filename, FILE* output, bool ignore_errors = false)
         : _filename(filename), _file(output), _chunk(0),
-          _ignore_errors(ignore_errors), _pbuf(0), failed(false)
+          _ignore_errors(ignore_errors), _pbuf(0), failed(false),
+          _buf_used(0), _buf_size(0)
     {
         ASSERT(output);
     }
     writer(vector<unsigned char>* poutput)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          _pbuf(poutput), failed(false) { ASSERT(poutput); }
+          _pbuf(poutput), failed(false), _buf_used(0), _buf_size(0)
+    {
+        ASSERT(poutput);
+    }
     writer(package *save, const string &chunkname)
         : _filename(), _file(0), _chunk(0), _ignore_errors(false),
-          failed(false)
+          failed(false), _buf_used(0), _buf_size(TAG_CHUNK_BUFFER)
     {
         ASSERT(save);
         _chunk = save->writer(chunkname);
     }
 
-    ~writer() { if (_chunk) delete _chunk; }
+    ~writer();
+
+    void writeByte(unsigned char byte)
+    {
+        if (_buf_used < _buf_size)
+            _buf[_buf_used++] = byte;
+        else
+            write_unbuffered(&byte, 1);
+    }
+
+    void write(const void *data, size_t size)
+    {
+        if (_buf_used + size <= _buf_size)
+        {
+            memcpy(_buf + _buf_used, data, size);
+            _buf_used += size;
+        }
+        else
+            write_unbuffered(data, size);
+    }
 
-    void writeByte(unsigned char byte);
-    void write(const void *data, size_t size);
     long tell();
 
     bool succeeded() const { return !failed; }
 
 private:
     void check_ok(bool ok);
+    void flush();
+    void write_unbuffered(const void *data, size_t size);
 
 private:
     string _filename;
@@ -88,6 +116,11 @@ private:
     vector<unsigned char>* _pbuf;
 
     bool failed;
+
+    // Only used when writing a chunk; _buf_size is 0 otherwise.
+    unsigned char _buf[TAG_CHUNK_BUFFER];
+    size_t _buf_used;
+    size_t _buf_size;
 };
 
 void marshallByte    (writer &, int8_t);
@@ -114,18 +147,44 @@ class reader
 public:
     reader(const string &filename, int minorVersion = TAG_MINOR_INVALID);
     reader(FILE* input, int minorVersion = TAG_MINOR_INVALID)
-        : _file(input), _chunk(0), opened_file(false), _pbuf(0),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+        : _file(input), _chunk(0), opened_file(false), _mem(0), _mem_size(0),
+          _read_offset(0), _minorVersion(minorVersion), _safe_read(false),
+          _buf_pos(0), _buf_len(0) {}
     reader(const vector<unsigned char>& input,
            int minorVersion = TAG_MINOR_INVALID)
-        : _file(0), _chunk(0), opened_file(false), _pbuf(&input),
-          _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+        : _file(0), _chunk(0), opened_file(false), _mem(input.data()),
+          _mem_size(input.size()), _read_offset(0),
+          _minorVersion(minorVersion), _safe_read(false),
+          _buf_pos(0), _buf_len(0) {}
+    // Reads memory the caller keeps alive, such as a mapped file.
+    reader(const unsigned char *input, size_t size,
+           int minorVersion = TAG_MINOR_INVALID)
+        : _file(0), _chunk(0), opened_file(false), _mem(input),
+          _mem_size(size), _read_offset(0), _minorVersion(minorVersion),
+          _safe_read(false), _buf_pos(0), _buf_len(0) {}
     reader(package *save, const string &chunkname,
            int minorVersion = TAG_MINOR_INVALID);
     ~reader();
 
-    unsigned char readByte();
-    void read(void *data, size_t size);
+    unsigned char readByte()
+    {
+        if (_buf_pos < _buf_len)
+            return _buf[_buf_pos++];
+        return read_byte_unbuffered();
+    }
+
+    void read(void *data, size_t size)
+    {
+        if (_buf_pos + size <= _buf_len)
+        {
+            if (data && size)
+                memcpy(data, _buf + _buf_pos, size);
+            _buf_pos += size;
+        }
+        else
+            read_unbuffered(data, size);
+    }
+
     void advance(size_t size);
     int getMinorVersion() const;
     void setMinorVersion(int minorVersion);
@@ -137,16 +196,27 @@ public:
 
     void set_safe_read(bool setting) { _safe_read = setting; }
 
+private:
+    unsigned char read_byte_unbuffered();
+    void read_unbuffered(void *data, size_t size);
+    bool fill_buffer();
+
 private:
     string _filename;
     FILE* _file;
     chunk_reader *_chunk;
     bool  opened_file;
-    const vector<unsigned char>* _pbuf;
+    const unsigned char *_mem;
+    size_t _mem_size;
     unsigned int _read_offset;
     int _minorVersion;
     // always throw an exception rather than dying when reading past EOF
     bool _safe_read;
+
+    // Read ahead from _chunk; unused otherwise.
+    unsigned char _buf[TAG_CHUNK_BUFFER];
+    size_t _buf_pos;
+    size_t _buf_len;
 };
 
 class short_read_exception : exception {};
@@ -2,7 +2,9 @@
 
 #ifndef TARGET_OS_WINDOWS
 
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
 
 #ifndef PTHREAD_CREATE_JOINABLE
 // AIX
@@ -53,6 +55,21 @@ static inline int unix_pthread_create(pthread_t *th, int det,
 #define cond_destroy(x) pthread_cond_destroy(&x)
 #define cond_wait(x,m) pthread_cond_wait(&x, &m)
 #define cond_wake(x) pthread_cond_signal(&x)
+// Returns false if ms milliseconds passed without a wakeup.
+static inline bool cond_timedwait(pthread_cond_t &x, pthread_mutex_t &m,
+                                  int ms)
+{
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(&x, &m, &deadline) != ETIMEDOUT;
+}
 
 
 #else
@@ -96,5 +113,12 @@ static inline int win32_thread_create_detached(thread_t *th,
 #define cond_destroy(x) CloseHandle(x);
 #define cond_wait(x,m) {mutex_unlock(m);WaitForSingleObject(x, INFINITE);mutex_lock(m);}
 #define cond_wake(x) PulseEvent(x)
+static inline bool cond_timedwait(HANDLE &x, CRITICAL_SECTION &m, int ms)
+{
+    LeaveCriticalSection(&m);
+    const DWORD ret = WaitForSingleObject(x, ms);
+    EnterCriticalSection(&m);
+    return ret != WAIT_TIMEOUT;
+}
 
 #endif
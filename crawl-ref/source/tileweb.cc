@@ -4,6 +4,7 @@
 
 #include "tileweb.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdarg>
 
@@ -66,6 +67,16 @@
 
 //#define DEBUG_WEBSOCKETS
 
+// How much output may be waiting for a single client. A spectator that falls
+// further behind than this loses its queued output and gets everything resent;
+// the game waits for its primary client instead.
+static const size_t MAX_QUEUED_BYTES = 2 * 1024 * 1024;
+// How long shutdown() keeps trying to deliver queued output, in milliseconds.
+static const unsigned int SHUTDOWN_DRAIN_TIME = 5000;
+// How long the game waits on a primary client that takes none of its output
+// before giving up on the connection, in milliseconds.
+static const unsigned int PRIMARY_STALL_TIME = 60 * 1000;
+
 static unsigned int get_milliseconds()
 {
     // This is Unix-only, but so is Webtiles at the moment.
@@ -78,6 +89,9 @@ static unsigned int get_milliseconds()
 TilesFramework tiles;
 
 TilesFramework::TilesFramework() :
+      m_sender_running(false),
+      m_sender_stop(false),
+      m_need_resync(false),
       m_controlled_from_web(false),
       _send_lock(false),
       m_last_ui_state(UI_INIT),
@@ -89,6 +103,7 @@ TilesFramework::TilesFramework() :
       m_current_flash_colour(BLACK),
       m_next_flash_colour(BLACK),
       m_need_full_map(true),
+      m_binary_map(false),
       m_text_menu("menu_txt"),
       m_print_fg(15)
 {
@@ -96,10 +111,17 @@ TilesFramework::TilesFramework() :
     default_cell.tile.bg = TILE_FLAG_UNSEEN;
     m_current_view.fill(default_cell);
     m_next_view.fill(default_cell);
+
+    mutex_init(m_send_mutex);
+    cond_init(m_send_cond);
+    cond_init(m_drain_cond);
 }
 
 TilesFramework::~TilesFramework()
 {
+    cond_destroy(m_drain_cond);
+    cond_destroy(m_send_cond);
+    mutex_destroy(m_send_mutex);
 }
 
 void TilesFramework::shutdown()
@@ -107,6 +129,7 @@ void TilesFramework::shutdown()
     if (m_sock_name.empty())
         return;
 
+    _stop_sender();
     close(m_sock);
     remove(m_sock_name.c_str());
 }
@@ -149,6 +172,8 @@ bool TilesFramework::initialise()
     if (setsockopt(m_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0)
         die("Can't set send timeout!");
 
+    _start_sender();
+
     if (m_await_connection)
         _await_connection();
 
@@ -186,8 +211,8 @@ void TilesFramework::finish_message()
     if (m_msg_buf.size() == 0)
         return;
 #ifdef DEBUG_WEBSOCKETS
-    const int initial_buf_size = m_msg_buf.size();
-    fprintf(stderr, "websocket: About to send %d bytes.\n", initial_buf_size);
+    fprintf(stderr, "websocket: About to queue %d bytes.\n",
+                                                (int) m_msg_buf.size());
 #endif
 
     if (m_sock_name.empty())
@@ -197,86 +222,230 @@ void TilesFramework::finish_message()
     }
 
     m_msg_buf.append("\n");
-    const char* fragment_start = m_msg_buf.data();
-    const char* data_end = m_msg_buf.data() + m_msg_buf.size();
-    int fragments = 0;
-    while (fragment_start < data_end)
+
+    mutex_lock(m_send_mutex);
+    if (m_send_error.empty())
     {
-        int fragment_size = data_end - fragment_start;
-        if (fragment_size > m_max_msg_size)
-            fragment_size = m_max_msg_size;
-        fragments++;
+        m_clients.erase(remove_if(m_clients.begin(), m_clients.end(),
+                                  [](const WebClient &c) { return c.dead; }),
+                        m_clients.end());
 
-        for (unsigned int i = 0; i < m_dest_addrs.size(); ++i)
-        {
-            int retries = 30;
-            ssize_t sent = 0;
-            while (sent < fragment_size)
-            {
-                ssize_t retval = sendto(m_sock, fragment_start + sent,
-                    fragment_size - sent, 0, (sockaddr*) &m_dest_addrs[i],
-                    sizeof(sockaddr_un));
-#ifdef DEBUG_WEBSOCKETS
-                fprintf(stderr,
-                            "    trying to send fragment to client %d...", i);
-#endif
-                if (retval <= 0)
-                {
-                    const char *errmsg = retval == 0 ? "No bytes sent"
-                                                     : strerror(errno);
-                    if (--retries <= 0)
-                        die("Socket write error: %s", errmsg);
+        for (WebClient &client : m_clients)
+            _queue_message(client);
 
-                    if (retval == 0 || errno == ENOBUFS || errno == EWOULDBLOCK
-                        || errno == EINTR || errno == EAGAIN)
-                    {
-                        // Wait for half a second at first (up to five), then
-                        // try again.
-                        const int sleep_time = retries > 25 ? 2 * 1000
-                                             : retries > 10 ? 500 * 1000
-                                             : 5000 * 1000;
-#ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr, "failed (%s), sleeping for %dms.\n",
-                                                    errmsg, sleep_time / 1000);
-#endif
-                        usleep(sleep_time);
-                    }
-                    else if (errno == ECONNREFUSED || errno == ENOENT)
-                    {
-                        // the other side is dead
+        cond_wake(m_send_cond);
+    }
+    const string error = m_send_error;
+    mutex_unlock(m_send_mutex);
+
+    // Not while holding the lock: dying sends more messages, and shutdown()
+    // needs the sender thread to get at the queues.
+    if (!error.empty())
+        die("Socket write error: %s", error.c_str());
+
+    m_msg_buf.clear();
+    m_need_flush = true;
 #ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr,
-                            "failed (%s), breaking.\n", errmsg);
+    // should the game actually crash in this case?
+    if (m_controlled_from_web && m_clients.size() == 0)
+        fprintf(stderr, "No open websockets after finish_message!!\n");
 #endif
-                        m_dest_addrs.erase(m_dest_addrs.begin() + i);
-                        i--;
-                        break;
-                    }
-                    else
-                        die("Socket write error: %s", errmsg);
-                }
-                else
+}
+
+// Called with m_send_mutex held.
+void TilesFramework::_queue_message(WebClient &client)
+{
+    if (client.queued_bytes + m_msg_buf.size() > MAX_QUEUED_BYTES
+        && client.queued_bytes > 0)
+    {
+        if (client.primary)
+        {
+            // It's the player's own connection: wait for it, as there's
+            // nothing better to do until they can see the game. The sender
+            // wakes us after every pass, so measure progress by the clock.
+            unsigned int stall_start = get_milliseconds();
+            while (!client.dead && client.queued_bytes > 0
+                   && client.queued_bytes + m_msg_buf.size()
+                      > MAX_QUEUED_BYTES)
+            {
+                const size_t queued = client.queued_bytes;
+                cond_timedwait(m_drain_cond, m_send_mutex, 1000);
+                if (client.queued_bytes < queued)
+                    stall_start = get_milliseconds();
+                else if (get_milliseconds() - stall_start > PRIMARY_STALL_TIME)
                 {
+                    // finish_message() dies with this once the lock is free.
+                    m_send_error = "Client stopped reading output";
+                    client.dead = true;
+                    client.queue.clear();
+                    client.queued_bytes = 0;
+                    client.sent = 0;
+                }
+            }
+            if (client.dead)
+                return;
+        }
+        else if (client.resynced)
+        {
+            // Couldn't even keep up with a resync, give up on it.
 #ifdef DEBUG_WEBSOCKETS
-                    fprintf(stderr, "fragment size %d sent.\n", fragment_size);
+            fprintf(stderr, "websocket: dropping a lagging spectator.\n");
 #endif
-                    sent += retval;
-                }
+            client.dead = true;
+            return;
+        }
+        else
+        {
+            // Throw away everything but a partially sent message, so that
+            // the other side still sees whole messages; flush_messages()
+            // will then resend the complete game state.
+            while (client.queue.size() > (client.sent ? 1 : 0))
+            {
+                client.queued_bytes -= client.queue.back().size();
+                client.queue.pop_back();
             }
+            client.resync_pending = true;
+            m_need_resync = true;
         }
-
-        fragment_start += fragment_size;
     }
-    m_msg_buf.clear();
-    m_need_flush = true;
-#ifdef DEBUG_WEBSOCKETS
-    // should the game actually crash in this case?
-    if (m_controlled_from_web && m_dest_addrs.size() == 0)
-        fprintf(stderr, "No open websockets after finish_message!!\n");
 
-    fprintf(stderr, "websocket: Sent %d bytes in %d fragments.\n",
-                                                initial_buf_size, fragments);
+    client.queue.push_back(m_msg_buf);
+    client.queued_bytes += m_msg_buf.size();
+}
+
+// Called with m_send_mutex held. Sends as much of the client's queue as the
+// socket takes without blocking, in fragments of at most m_max_msg_size bytes.
+// Returns false if the other side is backed up.
+bool TilesFramework::_send_queued(WebClient &client)
+{
+    while (!client.dead && !client.queue.empty())
+    {
+        const string &msg = client.queue.front();
+        const size_t fragment_size = min(msg.size() - client.sent,
+                                         (size_t) m_max_msg_size);
+        ssize_t retval = sendto(m_sock, msg.data() + client.sent,
+                                fragment_size, MSG_DONTWAIT,
+                                (sockaddr*) &client.addr, sizeof(sockaddr_un));
+        if (retval <= 0)
+        {
+            if (retval < 0 && errno == EINTR)
+                continue;
+            if (retval == 0 || errno == ENOBUFS || errno == EWOULDBLOCK
+                || errno == EAGAIN)
+            {
+                return false;
+            }
+
+            if (errno != ECONNREFUSED && errno != ENOENT)
+                m_send_error = strerror(errno);
+            // otherwise the other side is dead
+#ifdef DEBUG_WEBSOCKETS
+            fprintf(stderr, "websocket: send failed (%s), dropping client.\n",
+                            strerror(errno));
 #endif
+            client.dead = true;
+            client.queue.clear();
+            client.queued_bytes = 0;
+            client.sent = 0;
+            break;
+        }
+
+        client.sent += retval;
+        if (client.sent >= msg.size())
+        {
+            client.queued_bytes -= msg.size();
+            client.queue.pop_front();
+            client.sent = 0;
+        }
+    }
+
+    if (client.queue.empty())
+        client.resynced = false;
+    return true;
+}
+
+void *TilesFramework::_sender_main(void *arg)
+{
+    TilesFramework &tf = *static_cast<TilesFramework *>(arg);
+    unsigned int stop_time = 0;
+
+    mutex_lock(tf.m_send_mutex);
+    while (true)
+    {
+        bool blocked = false;
+        for (WebClient &client : tf.m_clients)
+            if (!tf._send_queued(client))
+                blocked = true;
+        cond_wake(tf.m_drain_cond);
+
+        if (tf.m_sender_stop)
+        {
+            if (!stop_time)
+                stop_time = get_milliseconds() + SHUTDOWN_DRAIN_TIME;
+            if (!blocked || get_milliseconds() > stop_time)
+                break;
+        }
+
+        if (blocked)
+        {
+            // Nothing tells us when a datagram socket has room again, so
+            // poll, without keeping the game out of the queues meanwhile.
+            mutex_unlock(tf.m_send_mutex);
+            usleep(2 * 1000);
+            mutex_lock(tf.m_send_mutex);
+        }
+        else
+            cond_wait(tf.m_send_cond, tf.m_send_mutex);
+    }
+    mutex_unlock(tf.m_send_mutex);
+
+    return nullptr;
+}
+
+void TilesFramework::_start_sender()
+{
+    m_sender_stop = false;
+    if (thread_create_joinable(&m_send_thread, _sender_main, this))
+        die("Can't start the webtiles sender thread!");
+    m_sender_running = true;
+}
+
+// Delivers what output it can, then stops the sender thread.
+void TilesFramework::_stop_sender()
+{
+    if (!m_sender_running)
+        return;
+
+    mutex_lock(m_send_mutex);
+    m_sender_stop = true;
+    cond_wake(m_send_cond);
+    mutex_unlock(m_send_mutex);
+
+    thread_join(m_send_thread);
+    m_sender_running = false;
+
+    // Nobody is left to send anything.
+    m_clients.clear();
+}
+
+// Resend the full game state after output to a lagging spectator had to be
+// dropped. Like a joining spectator, this goes to every client.
+void TilesFramework::_resync_clients()
+{
+    m_need_resync = false;
+
+    mutex_lock(m_send_mutex);
+    for (WebClient &client : m_clients)
+    {
+        if (client.resync_pending)
+        {
+            client.resync_pending = false;
+            client.resynced = true;
+        }
+    }
+    mutex_unlock(m_send_mutex);
+
+    _send_everything();
 }
 
 void TilesFramework::send_message(const char *format, ...)
@@ -305,6 +474,10 @@ void TilesFramework::flush_messages()
 {
     if (_send_lock)
         return;
+
+    if (m_need_resync)
+        _resync_clients();
+
     unwind_bool no_rentry(_send_lock, true);
 
     if (m_need_flush)
@@ -319,7 +492,7 @@ void TilesFramework::_await_connection()
     if (m_sock_name.empty())
         return;
 
-    while (m_dest_addrs.size() == 0)
+    while (m_clients.size() == 0)
         _receive_control_message();
 }
 
@@ -372,8 +545,34 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
     {
         JsonWrapper primary = json_find_member(obj.node, "primary");
         primary.check(JSON_BOOL);
-
-        m_dest_addrs.push_back(addr);
+        JsonWrapper binary_map = json_find_member(obj.node, "binary_map");
+        const bool wants_binary = binary_map.node
+                                  && binary_map->tag == JSON_BOOL
+                                  && binary_map->bool_;
+
+        WebClient client;
+        client.addr = addr;
+        client.primary = primary->bool_;
+        client.dead = false;
+        client.resync_pending = false;
+        client.resynced = false;
+        client.queued_bytes = 0;
+        client.sent = 0;
+
+        mutex_lock(m_send_mutex);
+        // Every client gets the same map messages, so only use the binary
+        // encoding if all of them understand it.
+        if (m_clients.empty())
+        {
+            m_binary_map = wants_binary;
+            // Tile deltas are against a map the client has just cleared.
+            if (wants_binary)
+                m_need_full_map = true;
+        }
+        else if (!wants_binary)
+            m_binary_map = false;
+        m_clients.push_back(client);
+        mutex_unlock(m_send_mutex);
         m_controlled_from_web = primary->bool_;
     }
     else if (msgtype == "key")
@@ -576,7 +775,9 @@ void TilesFramework::_send_version()
 #endif
 
     string title = CRAWL " " + string(Version::Long);
-    send_message("{\"msg\":\"version\",\"text\":\"%s\"}", title.c_str());
+    send_message("{\"msg\":\"version\",\"text\":\"%s\","
+                 "\"map_encoding\":\"%s\"}",
+                 title.c_str(), m_binary_map ? "binary" : "json");
 }
 
 void TilesFramework::_send_options()
@@ -1343,14 +1544,164 @@ void TilesFramework::write_tileidx(tileidx_t t)
         tiles.write_message("[%d,%d]", lo, hi);
 }
 
+/*
+  Binary map encoding
+
+  With m_binary_map, the regular per-cell fields of a map message are packed
+  into its "bin" member, base64 encoded; monsters, dolls and the like still
+  go into "cells" as JSON. The binary data is a header of varints
+      version, GXM, origin x, origin y (the last two zigzag encoded)
+  followed by one record per cell, in the order _send_map() visits them:
+      number of cells skipped since the last record
+      mask of the fields present (BinaryField)
+      the fields, in mask bit order.
+  Tile indices are sent as the difference of their low 32 bits from the
+  previous value for that cell (zigzag encoded, times two, plus one if the
+  high 32 bits follow in full), which is what the client already has.
+  BF_FLAGS packs the cell's booleans, in the order of _send_cell().
+ */
+enum BinaryField
+{
+    BF_FEAT,
+    BF_MAP_FEATURE,
+    BF_GLYPH,
+    BF_COLOUR,
+    BF_FG,
+    BF_BG,
+    BF_CLOUD,
+    BF_FLAGS,
+    BF_HALO,
+    BF_ORB_GLOW,
+    BF_BLOOD_ROTATION,
+    BF_TRAVEL_TRAIL,
+    BF_FLAVOUR,
+    BF_OVERLAYS,
+};
+
+#define BINARY_MAP_VERSION 1
+
+static void _write_varint(string &buf, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        buf.push_back((char) ((val & 0x7F) | 0x80));
+        val >>= 7;
+    }
+    buf.push_back((char) val);
+}
+
+static void _write_svarint(string &buf, int64_t val)
+{
+    _write_varint(buf, ((uint64_t) val << 1) ^ (uint64_t) (val >> 63));
+}
+
+static string _base64_encode(const string &data)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3)
+    {
+        const size_t n = min(data.size() - i, (size_t) 3);
+        uint32_t bits = (uint8_t) data[i] << 16;
+        if (n > 1)
+            bits |= (uint8_t) data[i + 1] << 8;
+        if (n > 2)
+            bits |= (uint8_t) data[i + 2];
+        out.push_back(digits[bits >> 18 & 0x3F]);
+        out.push_back(digits[bits >> 12 & 0x3F]);
+        out.push_back(n > 1 ? digits[bits >> 6 & 0x3F] : '=');
+        out.push_back(n > 2 ? digits[bits & 0x3F] : '=');
+    }
+    return out;
+}
+
+struct TilesFramework::BinaryCell
+{
+    uint32_t mask = 0;
+    string data;
+
+    string &field(BinaryField f)
+    {
+        mask |= 1 << f;
+        return data;
+    }
+
+    void write_tile(BinaryField f, tileidx_t next, tileidx_t current)
+    {
+        // Zigzag the low word's delta, on unsigned values so that no
+        // negative number is shifted.
+        const uint32_t d = (uint32_t) next - (uint32_t) current;
+        const uint32_t zz = (d << 1) ^ (0u - (d >> 31));
+        const bool hi_changed = (next >> 32) != (current >> 32);
+        _write_varint(field(f), ((uint64_t) zz << 1) | hi_changed);
+        if (hi_changed)
+            _write_varint(data, next >> 32);
+    }
+
+    // Everything _send_cell() writes between the cloud and the doll.
+    void write_tile_flags(const packed_cell &next, const packed_cell &current,
+                          bool force_full)
+    {
+        const bool next_flags[] =
+        {
+            next.is_bloody, next.old_blood, next.is_silenced,
+            next.is_highlighted_summoner, next.is_sanctuary,
+            next.is_liquefied, next.quad_glow, (bool) next.disjunct,
+            next.mangrove_water, next.awakened_forest,
+        };
+        const bool current_flags[] =
+        {
+            current.is_bloody, current.old_blood, current.is_silenced,
+            current.is_highlighted_summoner, current.is_sanctuary,
+            current.is_liquefied, current.quad_glow, (bool) current.disjunct,
+            current.mangrove_water, current.awakened_forest,
+        };
+        uint32_t flags = 0;
+        bool flags_changed = false;
+        for (unsigned int i = 0; i < ARRAYSZ(next_flags); ++i)
+        {
+            flags |= next_flags[i] << i;
+            flags_changed |= next_flags[i] != current_flags[i];
+        }
+        if (flags_changed)
+            _write_varint(field(BF_FLAGS), flags);
+
+        if (next.halo != current.halo)
+            _write_svarint(field(BF_HALO), next.halo);
+        if (next.orb_glow != current.orb_glow)
+            _write_svarint(field(BF_ORB_GLOW), next.orb_glow);
+        if (next.blood_rotation != current.blood_rotation)
+            _write_svarint(field(BF_BLOOD_ROTATION), next.blood_rotation);
+        if (next.travel_trail != current.travel_trail)
+            _write_svarint(field(BF_TRAVEL_TRAIL), next.travel_trail);
+
+        if (_needs_flavour(next)
+            && (next.flv.floor != current.flv.floor
+                || next.flv.special != current.flv.special
+                || !_needs_flavour(current)
+                || force_full))
+        {
+            _write_varint(field(BF_FLAVOUR), next.flv.floor);
+            _write_varint(data, next.flv.special);
+        }
+    }
+};
+
 void TilesFramework::_send_cell(const coord_def &gc,
                                 const screen_cell_t &current_sc, const screen_cell_t &next_sc,
                                 const map_cell &current_mc, const map_cell &next_mc,
                                 map<uint32_t, coord_def>& new_monster_locs,
-                                bool force_full)
+                                bool force_full, BinaryCell *bin)
 {
     if (current_mc.feat() != next_mc.feat())
-        json_write_int("f", next_mc.feat());
+    {
+        if (bin)
+            _write_varint(bin->field(BF_FEAT), next_mc.feat());
+        else
+            json_write_int("f", next_mc.feat());
+    }
 
     if (next_mc.monsterinfo())
         _send_monster(gc, next_mc.monsterinfo(), new_monster_locs, force_full);
@@ -1359,22 +1710,35 @@ void TilesFramework::_send_cell(const coord_def &gc,
 
     map_feature mf = get_cell_map_feature(gc);
     if (get_cell_map_feature(current_mc) != mf)
-        json_write_int("mf", mf);
+    {
+        if (bin)
+            _write_varint(bin->field(BF_MAP_FEATURE), mf);
+        else
+            json_write_int("mf", mf);
+    }
 
     // Glyph and colour
     char32_t glyph = next_sc.glyph;
     if (current_sc.glyph != glyph)
     {
-        char buf[5];
-        buf[wctoutf8(buf, glyph)] = 0;
-        json_write_string("g", buf);
+        if (bin)
+            _write_varint(bin->field(BF_GLYPH), glyph);
+        else
+        {
+            char buf[5];
+            buf[wctoutf8(buf, glyph)] = 0;
+            json_write_string("g", buf);
+        }
     }
     if ((current_sc.colour != next_sc.colour
          || current_sc.glyph == ' ') && glyph != ' ')
     {
         int col = next_sc.colour;
         col = (_get_brand(col) << 4) | macro_colour(col & 0xF);
-        json_write_int("col", col);
+        if (bin)
+            _write_varint(bin->field(BF_COLOUR), col);
+        else
+            json_write_int("col", col);
     }
 
     json_open_object("t");
@@ -1392,81 +1756,101 @@ void TilesFramework::_send_cell(const coord_def &gc,
         {
             fg_changed = true;
 
-            json_write_name("fg");
-            write_tileidx(next_pc.fg);
+            if (bin)
+                bin->write_tile(BF_FG, next_pc.fg, current_pc.fg);
+            else
+            {
+                json_write_name("fg");
+                write_tileidx(next_pc.fg);
+            }
             if (get_tile_texture(fg_idx) == TEX_DEFAULT)
                 json_write_int("base", (int) tileidx_known_base_item(fg_idx));
         }
 
         if (next_pc.bg != current_pc.bg)
         {
-            json_write_name("bg");
-            write_tileidx(next_pc.bg);
+            if (bin)
+                bin->write_tile(BF_BG, next_pc.bg, current_pc.bg);
+            else
+            {
+                json_write_name("bg");
+                write_tileidx(next_pc.bg);
+            }
         }
 
         if (next_pc.cloud != current_pc.cloud)
         {
-            json_write_name("cloud");
-            write_tileidx(next_pc.cloud);
+            if (bin)
+                bin->write_tile(BF_CLOUD, next_pc.cloud, current_pc.cloud);
+            else
+            {
+                json_write_name("cloud");
+                write_tileidx(next_pc.cloud);
+            }
         }
 
-        if (next_pc.is_bloody != current_pc.is_bloody)
-            json_write_bool("bloody", next_pc.is_bloody);
+        if (bin)
+            bin->write_tile_flags(next_pc, current_pc, force_full);
+        else
+        {
+            if (next_pc.is_bloody != current_pc.is_bloody)
+                json_write_bool("bloody", next_pc.is_bloody);
 
-        if (next_pc.old_blood != current_pc.old_blood)
-            json_write_bool("old_blood", next_pc.old_blood);
+            if (next_pc.old_blood != current_pc.old_blood)
+                json_write_bool("old_blood", next_pc.old_blood);
 
-        if (next_pc.is_silenced != current_pc.is_silenced)
-            json_write_bool("silenced", next_pc.is_silenced);
+            if (next_pc.is_silenced != current_pc.is_silenced)
+                json_write_bool("silenced", next_pc.is_silenced);
 
-        if (next_pc.halo != current_pc.halo)
-            json_write_int("halo", next_pc.halo);
+            if (next_pc.halo != current_pc.halo)
+                json_write_int("halo", next_pc.halo);
 
-        if (next_pc.is_highlighted_summoner
-            != current_pc.is_highlighted_summoner)
-        {
-            json_write_bool("highlighted_summoner",
-                            next_pc.is_highlighted_summoner);
-        }
+            if (next_pc.is_highlighted_summoner
+                != current_pc.is_highlighted_summoner)
+            {
+                json_write_bool("highlighted_summoner",
+                                next_pc.is_highlighted_summoner);
+            }
 
-        if (next_pc.is_sanctuary != current_pc.is_sanctuary)
-            json_write_bool("sanctuary", next_pc.is_sanctuary);
+            if (next_pc.is_sanctuary != current_pc.is_sanctuary)
+                json_write_bool("sanctuary", next_pc.is_sanctuary);
 
-        if (next_pc.is_liquefied != current_pc.is_liquefied)
-            json_write_bool("liquefied", next_pc.is_liquefied);
+            if (next_pc.is_liquefied != current_pc.is_liquefied)
+                json_write_bool("liquefied", next_pc.is_liquefied);
 
-        if (next_pc.orb_glow != current_pc.orb_glow)
-            json_write_int("orb_glow", next_pc.orb_glow);
+            if (next_pc.orb_glow != current_pc.orb_glow)
+                json_write_int("orb_glow", next_pc.orb_glow);
 
-        if (next_pc.quad_glow != current_pc.quad_glow)
-            json_write_bool("quad_glow", next_pc.quad_glow);
+            if (next_pc.quad_glow != current_pc.quad_glow)
+                json_write_bool("quad_glow", next_pc.quad_glow);
 
-        if (next_pc.disjunct != current_pc.disjunct)
-            json_write_bool("disjunct", next_pc.disjunct);
+            if (next_pc.disjunct != current_pc.disjunct)
+                json_write_bool("disjunct", next_pc.disjunct);
 
-        if (next_pc.mangrove_water != current_pc.mangrove_water)
-            json_write_bool("mangrove_water", next_pc.mangrove_water);
+            if (next_pc.mangrove_water != current_pc.mangrove_water)
+                json_write_bool("mangrove_water", next_pc.mangrove_water);
 
-        if (next_pc.awakened_forest != current_pc.awakened_forest)
-            json_write_bool("awakened_forest", next_pc.awakened_forest);
+            if (next_pc.awakened_forest != current_pc.awakened_forest)
+                json_write_bool("awakened_forest", next_pc.awakened_forest);
 
-        if (next_pc.blood_rotation != current_pc.blood_rotation)
-            json_write_int("blood_rotation", next_pc.blood_rotation);
+            if (next_pc.blood_rotation != current_pc.blood_rotation)
+                json_write_int("blood_rotation", next_pc.blood_rotation);
 
-        if (next_pc.travel_trail != current_pc.travel_trail)
-            json_write_int("travel_trail", next_pc.travel_trail);
+            if (next_pc.travel_trail != current_pc.travel_trail)
+                json_write_int("travel_trail", next_pc.travel_trail);
 
-        if (_needs_flavour(next_pc) &&
-            (next_pc.flv.floor != current_pc.flv.floor
-             || next_pc.flv.special != current_pc.flv.special
-             || !_needs_flavour(current_pc)
-             || force_full))
-        {
-            json_open_object("flv");
-            json_write_int("f", next_pc.flv.floor);
-            if (next_pc.flv.special)
-                json_write_int("s", next_pc.flv.special);
-            json_close_object();
+            if (_needs_flavour(next_pc) &&
+                (next_pc.flv.floor != current_pc.flv.floor
+                 || next_pc.flv.special != current_pc.flv.special
+                 || !_needs_flavour(current_pc)
+                 || force_full))
+            {
+                json_open_object("flv");
+                json_write_int("f", next_pc.flv.floor);
+                if (next_pc.flv.special)
+                    json_write_int("s", next_pc.flv.special);
+                json_close_object();
+            }
         }
 
         if (fg_idx >= TILEP_MCACHE_START)
@@ -1561,7 +1945,14 @@ void TilesFramework::_send_cell(const coord_def &gc,
             }
         }
 
-        if (overlays_changed)
+        if (overlays_changed && bin)
+        {
+            string &buf = bin->field(BF_OVERLAYS);
+            _write_varint(buf, next_pc.num_dngn_overlay);
+            for (int i = 0; i < next_pc.num_dngn_overlay; ++i)
+                _write_varint(buf, next_pc.dngn_overlay[i]);
+        }
+        else if (overlays_changed)
         {
             json_open_array("ov");
             for (int i = 0; i < next_pc.num_dngn_overlay; ++i)
@@ -1590,22 +1981,23 @@ void TilesFramework::_mcache_ref(bool inc)
 {
     for (int y = 0; y < GYM; y++)
         for (int x = 0; x < GXM; x++)
-        {
-            coord_def gc(x, y);
+            _mcache_ref(coord_def(x, y), inc);
+}
 
-            int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
-            if (fg_idx >= TILEP_MCACHE_START)
-            {
-                mcache_entry *entry = mcache.get(fg_idx);
-                if (entry)
-                {
-                    if (inc)
-                        entry->inc_ref();
-                    else
-                        entry->dec_ref();
-                }
-            }
+void TilesFramework::_mcache_ref(const coord_def &gc, bool inc)
+{
+    int fg_idx = m_current_view(gc).tile.fg & TILE_FLAG_MASK;
+    if (fg_idx >= TILEP_MCACHE_START)
+    {
+        mcache_entry *entry = mcache.get(fg_idx);
+        if (entry)
+        {
+            if (inc)
+                entry->inc_ref();
+            else
+                entry->dec_ref();
         }
+    }
 }
 
 void TilesFramework::_send_map(bool force_full)
@@ -1654,57 +2046,102 @@ void TilesFramework::_send_map(bool force_full)
     coord_def last_gc(0, 0);
     bool send_gc = true;
 
+    string bin_cells;
+    int last_bin_index = -1;
+
+    // Both encodings rely on visiting cells in row-major order.
+    vector<coord_def> send_locs;
+    if (force_full)
+    {
+        send_locs.reserve(GXM * GYM);
+        for (int y = 0; y < GYM; y++)
+            for (int x = 0; x < GXM; x++)
+                send_locs.emplace_back(x, y);
+    }
+    else
+    {
+        for (const coord_def &gc : m_dirty_locs)
+            if (is_dirty(gc))
+                send_locs.push_back(gc);
+        sort(send_locs.begin(), send_locs.end(),
+             [](const coord_def &a, const coord_def &b)
+             {
+                 return a.y < b.y || a.y == b.y && a.x < b.x;
+             });
+        send_locs.erase(unique(send_locs.begin(), send_locs.end()),
+                        send_locs.end());
+    }
+    m_dirty_locs.clear();
+
     json_open_array("cells");
-    for (int y = 0; y < GYM; y++)
-        for (int x = 0; x < GXM; x++)
-        {
-            coord_def gc(x, y);
+    for (const coord_def &gc : send_locs)
+    {
+        const int x = gc.x, y = gc.y;
 
-            if (!is_dirty(gc) && !force_full)
-                continue;
+        if (cell_needs_redraw(gc))
+        {
+            screen_cell_t *cell = &m_next_view(gc);
 
-            if (cell_needs_redraw(gc))
-            {
-                screen_cell_t *cell = &m_next_view(gc);
+            draw_cell(cell, gc, false, m_current_flash_colour);
+            pack_cell_overlays(gc, m_next_view);
+        }
 
-                draw_cell(cell, gc, false, m_current_flash_colour);
-                pack_cell_overlays(gc, m_next_view);
-            }
+        mark_clean(gc);
 
-            mark_clean(gc);
+        if (m_origin.equals(-1, -1))
+            m_origin = gc;
 
-            if (m_origin.equals(-1, -1))
-                m_origin = gc;
+        json_open_object();
+        if (send_gc
+            || last_gc.x + 1 != gc.x
+            || last_gc.y != gc.y)
+        {
+            json_write_int("x", x - m_origin.x);
+            json_write_int("y", y - m_origin.y);
+            json_treat_as_empty();
+        }
 
-            json_open_object();
-            if (send_gc
-                || last_gc.x + 1 != gc.x
-                || last_gc.y != gc.y)
-            {
-                json_write_int("x", x - m_origin.x);
-                json_write_int("y", y - m_origin.y);
-                json_treat_as_empty();
-            }
+        const screen_cell_t& sc = force_full ? default_cell
+            : m_current_view(gc);
+        const map_cell& mc = force_full ? default_map_cell
+            : m_current_map_knowledge(gc);
+        BinaryCell bin;
+        _send_cell(gc,
+                   sc,
+                   m_next_view(gc),
+                   mc, env.map_knowledge(gc),
+                   new_monster_locs, force_full,
+                   m_binary_map ? &bin : nullptr);
+
+        if (bin.mask)
+        {
+            const int index = y * GXM + x;
+            _write_varint(bin_cells, index - last_bin_index - 1);
+            _write_varint(bin_cells, bin.mask);
+            bin_cells += bin.data;
+            last_bin_index = index;
+        }
 
-            const screen_cell_t& sc = force_full ? default_cell
-                : m_current_view(gc);
-            const map_cell& mc = force_full ? default_map_cell
-                : m_current_map_knowledge(gc);
-            _send_cell(gc,
-                       sc,
-                       m_next_view(gc),
-                       mc, env.map_knowledge(gc),
-                       new_monster_locs, force_full);
-
-            if (!json_is_empty())
-            {
-                send_gc = false;
-                last_gc = gc;
-            }
-            json_close_object(true);
+        if (!json_is_empty())
+        {
+            send_gc = false;
+            last_gc = gc;
         }
+        json_close_object(true);
+    }
     json_close_array(true);
 
+    if (!bin_cells.empty())
+    {
+        string bin;
+        _write_varint(bin, BINARY_MAP_VERSION);
+        _write_varint(bin, GXM);
+        _write_svarint(bin, m_origin.x);
+        _write_svarint(bin, m_origin.y);
+        bin += bin_cells;
+        json_write_string("bin", _base64_encode(bin));
+    }
+
     json_close_object(true);
 
     finish_message();
@@ -1712,14 +2149,26 @@ void TilesFramework::_send_map(bool force_full)
     if (force_full)
         _send_cursor(CURSOR_MAP);
 
-    if (m_mcache_ref_done)
-        _mcache_ref(false);
+    // Only the cells just sent can differ from what the client has; cells
+    // not marked dirty are left alone, so that m_current_view and
+    // m_current_map_knowledge keep matching what was actually sent.
+    for (const coord_def &gc : send_locs)
+    {
+        if (m_mcache_ref_done)
+            _mcache_ref(gc, false);
+
+        m_current_map_knowledge(gc) = env.map_knowledge(gc);
+        m_current_view(gc) = m_next_view(gc);
 
-    m_current_map_knowledge = env.map_knowledge;
-    m_current_view = m_next_view;
+        if (m_mcache_ref_done)
+            _mcache_ref(gc, true);
+    }
 
-    _mcache_ref(true);
-    m_mcache_ref_done = true;
+    if (!m_mcache_ref_done)
+    {
+        _mcache_ref(true);
+        m_mcache_ref_done = true;
+    }
 
     m_monster_locs = new_monster_locs;
 }
@@ -2185,7 +2634,11 @@ void TilesFramework::mark_for_redraw(const coord_def& gc)
 
 void TilesFramework::mark_dirty(const coord_def& gc)
 {
-    m_dirty_cells[gc.y * GXM + gc.x] = true;
+    if (!m_dirty_cells[gc.y * GXM + gc.x])
+    {
+        m_dirty_cells[gc.y * GXM + gc.x] = true;
+        m_dirty_locs.push_back(gc);
+    }
 }
 
 void TilesFramework::mark_clean(const coord_def& gc)
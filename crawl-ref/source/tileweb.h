@@ -8,6 +8,7 @@
 #ifdef USE_TILE_WEB
 
 #include <bitset>
+#include <deque>
 #include <map>
 #include <vector>
 
@@ -19,6 +20,7 @@
 #include "map-knowledge.h"
 #include "status.h"
 #include "text-tag-type.h"
+#include "threads.h"
 #include "tiledoll.h"
 #include "tilemcache.h"
 #include "tileweb-text.h"
@@ -153,7 +155,7 @@ public:
     void send_message(PRINTF(1, ));
     void flush_messages();
 
-    bool has_receivers() { return !m_dest_addrs.empty(); }
+    bool has_receivers() { return !m_clients.empty(); }
     bool is_controlled_from_web() { return m_controlled_from_web; }
 
     /* Webtiles can receive input both via stdin, and on the
@@ -220,7 +222,37 @@ protected:
     int m_sock;
     int m_max_msg_size;
     string m_msg_buf;
-    vector<sockaddr_un> m_dest_addrs;
+
+    // Finished messages are queued per destination and written to the
+    // socket by a sender thread, so that one backed-up spectator can't stall
+    // the game. Everything in here is guarded by m_send_mutex.
+    struct WebClient
+    {
+        sockaddr_un addr;
+        bool primary;
+        bool dead;
+        bool resync_pending; // dropped output, waiting for _send_everything()
+        bool resynced;       // resent everything, not yet caught up
+        deque<string> queue;
+        size_t queued_bytes;
+        size_t sent;         // bytes of queue.front() already sent
+    };
+    vector<WebClient> m_clients;
+    mutex_t m_send_mutex;
+    cond_t m_send_cond;      // more output queued, or stop requested
+    cond_t m_drain_cond;     // the sender thread made progress
+    thread_t m_send_thread;
+    bool m_sender_running;
+    bool m_sender_stop;
+    string m_send_error;
+    bool m_need_resync;
+
+    static void *_sender_main(void *arg);
+    void _start_sender();
+    void _stop_sender();
+    bool _send_queued(WebClient &client);
+    void _queue_message(WebClient &client);
+    void _resync_clients();
 
     bool m_controlled_from_web;
     bool m_need_flush;
@@ -275,6 +307,9 @@ protected:
 
     bitset<GXM * GYM> m_dirty_cells;
     bitset<GXM * GYM> m_cells_needing_redraw;
+    // Cells that were marked dirty, in no particular order and possibly
+    // repeated; lets _send_map() visit only those.
+    vector<coord_def> m_dirty_locs;
     void mark_dirty(const coord_def& gc);
     void mark_clean(const coord_def& gc);
     bool is_dirty(const coord_def& gc);
@@ -286,6 +321,9 @@ protected:
     FixedArray<map_cell, GXM, GYM> m_current_map_knowledge;
     map<uint32_t, coord_def> m_monster_locs;
     bool m_need_full_map;
+    // Whether every client asked for map cells in the binary encoding
+    // instead of JSON; see _send_map().
+    bool m_binary_map;
 
     coord_def m_cursor[CURSOR_MAX];
     coord_def m_last_clicked_grid;
@@ -314,14 +352,16 @@ protected:
 
     bool m_mcache_ref_done;
     void _mcache_ref(bool inc);
+    void _mcache_ref(const coord_def &gc, bool inc);
 
     void _send_cursor(cursor_type type);
     void _send_map(bool force_full = false);
+    struct BinaryCell;
     void _send_cell(const coord_def &gc,
                     const screen_cell_t &current_sc, const screen_cell_t &next_sc,
                     const map_cell &current_mc, const map_cell &next_mc,
                     map<uint32_t, coord_def>& new_monster_locs,
-                    bool force_full);
+                    bool force_full, BinaryCell *bin = nullptr);
     void _send_monster(const coord_def &gc, const monster_info* m,
                        map<uint32_t, coord_def>& new_monster_locs,
                        bool force_full);
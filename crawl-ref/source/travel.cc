@@ -15,6 +15,7 @@
 #include <cstdarg>
 #include <cstdio>
 #include <memory>
+#include <queue>
 #include <set>
 #include <sstream>
 
@@ -192,6 +193,7 @@ static bool _is_travelsafe_square(const coord_def& c,
                                   bool ignore_hostile = false,
                                   bool ignore_danger = false,
                                   bool try_fallback = false);
+static void _forget_distance_fields();
 
 // Returns true if there is a known trap at (x,y). Returns false for non-trap
 // squares as also for undiscovered traps.
@@ -573,6 +575,7 @@ void travel_init_new_level()
     you.running = runmode;
 
     travel_init_load_level();
+    _forget_distance_fields();
 
     explore_stopped_pos.reset();
 }
@@ -676,6 +679,8 @@ static void _start_running()
 
     if (you.running < 0)
         start_delay<TravelDelay>(unsafe);
+
+    _forget_distance_fields();
 }
 
 // Stops shift+running and all forms of travel.
@@ -754,6 +759,7 @@ static void _explore_find_target_square()
 
     travel_pathfind tp;
     tp.set_floodseed(you.pos(), true);
+    tp.set_use_distance_field(true);
 
     coord_def whereto =
         tp.pathfind(static_cast<run_mode_type>(you.running.runmode));
@@ -1120,6 +1126,487 @@ static void _fill_exclude_radius(const travel_exclude &exc)
 
 FixedVector<coord_def, GXM * GYM> travel_pathfind::circumference[2];
 
+static travel_flood_stats flood_stats;
+// Off only for benchmarks and tests that compare against plain floods.
+static bool distance_fields_enabled = true;
+
+// What a distance field depends on besides the map squares themselves. A
+// change to any of these starts a new field.
+struct distance_field_key
+{
+    level_id level;
+    coord_def seed;
+    bool ignore_danger;
+    bool try_fallback;
+    int traversal;
+    unsigned int exclusions;
+    vector<transporter_info> transporters;
+
+    bool operator==(const distance_field_key &other) const;
+};
+
+static bool _same_transporters(const vector<transporter_info> &a,
+                               const vector<transporter_info> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (unsigned int i = 0; i < a.size(); ++i)
+        if (a[i].position != b[i].position
+            || a[i].destination != b[i].destination)
+        {
+            return false;
+        }
+    return true;
+}
+
+bool distance_field_key::operator==(const distance_field_key &other) const
+{
+    return level == other.level && seed == other.seed
+           && ignore_danger == other.ignore_danger
+           && try_fallback == other.try_fallback
+           && traversal == other.traversal
+           && exclusions == other.exclusions
+           && _same_transporters(transporters, other.transporters);
+}
+
+// The player abilities that decide which terrain travel may cross, and how
+// fast; see feat_is_traversable_now() and _is_travelsafe_square().
+static int _travel_traversal_state()
+{
+    return (you.permanent_flight() ? 1 : 0)
+           | (player_likes_water(true) ? 2 : 0)
+           | (have_passive(passive_t::water_walk) ? 4 : 0)
+           | (actor_slime_wall_immune(&you) ? 8 : 0);
+}
+
+// Where the player was at each distance field query of the current run.
+// The map only changes where the player can see, so these are the squares
+// a field needs to recheck.
+static vector<coord_def> _run_views;
+
+// Does c have unexplored neighbours? Explore floods for such squares.
+static bool _borders_unexplored(const coord_def &c)
+{
+    for (adjacent_iterator ai(c); ai; ++ai)
+        if (in_bounds(*ai) && !env.map_knowledge(*ai).seen())
+            return true;
+    return false;
+}
+
+// A travel flood from one seed square, kept from one query to the next.
+//
+// Travel floods the level again on every step, and explore on every new
+// target. A distance field instead remembers how far each square is from
+// its seed the way path_flood() counts it: a square's traversal cost is
+// paid on leaving it, and transporter landing sites lead back to their
+// transporters. Squares are settled nearest first, and only as far out as
+// a query needs, so building a field costs no more than the flood it
+// replaces.
+//
+// Between queries the map only changes where the player can see, so each
+// query rechecks the squares in view of wherever the player has been since
+// the last one, and repairs just the distances that went through squares
+// that changed. Fields last for one run; see _forget_distance_fields().
+class travel_distance_field
+{
+public:
+    explicit travel_distance_field(const distance_field_key &k);
+
+    const distance_field_key key;
+
+    void refresh();
+
+    // The distance of the nearest unsettled square, and settling it.
+    int unsettled_distance();
+    coord_def settle_next();
+
+    bool is_settled(const coord_def &c) const { return settled(c); }
+    bool is_safe(const coord_def &c) const { return safe(c); }
+    int leave_distance(const coord_def &c) const { return dist(c) + cost(c); }
+
+    coord_def travel_move(const coord_def &dest);
+    const vector<coord_def> &unexplored_borders();
+    void export_distances(travel_distance_grid_t grid) const;
+
+private:
+    typedef pair<coord_def, int> coord_dist;
+
+    // A square whose travel safety or cost changed since it was last
+    // looked at.
+    struct square_change
+    {
+        coord_def pos;
+        bool was_safe;
+        int old_cost;
+    };
+
+    void look_up(const coord_def &c);
+    void repair(const vector<square_change> &changes);
+    bool supported(const coord_def &c) const;
+    void reenter(const coord_def &c);
+    void relax(const coord_def &c);
+
+    template<typename F> void for_each_exit(const coord_def &c, F f) const;
+    template<typename F> void for_each_entry(const coord_def &c, F f) const;
+
+    // Distance from the seed, or INFINITE_DISTANCE if not reached yet.
+    FixedArray<int, GXM, GYM> dist;
+    // What it costs to leave each square, or 0 if not looked up yet.
+    FixedArray<int8_t, GXM, GYM> cost;
+    FixedBitArray<GXM, GYM> safe;
+    FixedBitArray<GXM, GYM> settled;
+
+    // Settled squares that bordered unexplored territory when settled.
+    FixedBitArray<GXM, GYM> bordering;
+    vector<coord_def> border_squares;
+
+    priority_queue<coord_dist, vector<coord_dist>,
+                   greater_second<coord_dist> > queue;
+
+    // The first of _run_views not checked since.
+    size_t first_view;
+};
+
+travel_distance_field::travel_distance_field(const distance_field_key &k)
+    : key(k), border_squares(), queue(), first_view(_run_views.size())
+{
+    dist.init(INFINITE_DISTANCE);
+    cost.init(0);
+
+    look_up(key.seed);
+    dist(key.seed) = 0;
+    queue.push(coord_dist(key.seed, 0));
+}
+
+// Notes whether the flood may step onto c, and what leaving c costs.
+void travel_distance_field::look_up(const coord_def &c)
+{
+    cost(c) = _feature_traverse_cost(env.map_knowledge(c).feat());
+    safe.set(c, _is_travelsafe_square(c, false, key.ignore_danger,
+                                      key.try_fallback));
+}
+
+// Calls f for each square the flood steps onto from c; see
+// path_examine_point().
+template<typename F>
+void travel_distance_field::for_each_exit(const coord_def &c, F f) const
+{
+    for (int dir = 0; dir < 8; (dir += 2) == 8 && (dir = 1))
+    {
+        const coord_def dc = c + Compass[dir];
+        if (in_bounds(dc))
+            f(dc);
+    }
+
+    if (env.grid(c) == DNGN_TRANSPORTER_LANDING)
+        for (const transporter_info &ti : key.transporters)
+            if (ti.destination == c)
+                f(ti.position);
+}
+
+// Calls f for each square the flood steps onto c from.
+template<typename F>
+void travel_distance_field::for_each_entry(const coord_def &c, F f) const
+{
+    for (int dir = 0; dir < 8; (dir += 2) == 8 && (dir = 1))
+    {
+        const coord_def dc = c + Compass[dir];
+        if (in_bounds(dc))
+            f(dc);
+    }
+
+    for (const transporter_info &ti : key.transporters)
+        if (ti.position == c && in_bounds(ti.destination)
+            && env.grid(ti.destination) == DNGN_TRANSPORTER_LANDING)
+        {
+            f(ti.destination);
+        }
+}
+
+// Offers each square the flood steps onto from c a path through c.
+void travel_distance_field::relax(const coord_def &c)
+{
+    const int through = leave_distance(c);
+    for_each_exit(c, [&](const coord_def &dc)
+    {
+        if (!cost(dc))
+            look_up(dc);
+        if (safe(dc) && through < dist(dc))
+        {
+            dist(dc) = through;
+            settled.set(dc, false);
+            queue.push(coord_dist(dc, through));
+        }
+    });
+}
+
+int travel_distance_field::unsettled_distance()
+{
+    while (!queue.empty())
+    {
+        const coord_dist &next = queue.top();
+        if (!settled(next.first) && dist(next.first) == next.second)
+            return next.second;
+
+        // Settled since, or offered a shorter path.
+        queue.pop();
+    }
+    return INFINITE_DISTANCE;
+}
+
+// Only call this if unsettled_distance() found a square.
+coord_def travel_distance_field::settle_next()
+{
+    const coord_def c = queue.top().first;
+    queue.pop();
+    settled.set(c);
+    flood_stats.field_settled++;
+    relax(c);
+
+    if (!bordering(c) && _borders_unexplored(c))
+    {
+        bordering.set(c);
+        border_squares.push_back(c);
+    }
+    return c;
+}
+
+// The square from which the flood first steps onto dest, settling only
+// as far as it takes to be sure. Of equally near squares, orthogonal
+// neighbours win, so that the path doesn't zigzag.
+coord_def travel_distance_field::travel_move(const coord_def &dest)
+{
+    vector<coord_def> entries;
+    for_each_entry(dest, [&](const coord_def &c) { entries.push_back(c); });
+
+    int best = INFINITE_DISTANCE;
+    for (const coord_def &c : entries)
+        if (settled(c))
+            best = min(best, leave_distance(c));
+
+    while (unsettled_distance() < best)
+    {
+        const coord_def c = settle_next();
+        if (find(entries.begin(), entries.end(), c) != entries.end())
+            best = min(best, leave_distance(c));
+    }
+
+    for (const coord_def &c : entries)
+        if (settled(c) && leave_distance(c) == best)
+            return c;
+    return coord_def();
+}
+
+// Settled squares next to unexplored territory.
+const vector<coord_def> &travel_distance_field::unexplored_borders()
+{
+    erase_if(border_squares, [this](const coord_def &c)
+    {
+        if (_borders_unexplored(c))
+            return false;
+        bordering.set(c, false);
+        return true;
+    });
+    return border_squares;
+}
+
+void travel_distance_field::export_distances(travel_distance_grid_t grid) const
+{
+    for (int x = 0; x < GXM; ++x)
+        for (int y = 0; y < GYM; ++y)
+            grid[x][y] = dist[x][y] == INFINITE_DISTANCE ? 0 : dist[x][y];
+}
+
+// Rechecks the squares the player could see since the last query, since
+// the map may have changed there, and repairs the distances that depended
+// on them.
+void travel_distance_field::refresh()
+{
+    if (_run_views.empty() || _run_views.back() != you.pos())
+        _run_views.push_back(you.pos());
+
+    FixedBitArray<GXM, GYM> checked;
+    vector<square_change> changes;
+    for (size_t i = first_view; i < _run_views.size(); ++i)
+        for (rectangle_iterator ri(_run_views[i], LOS_RADIUS, true); ri; ++ri)
+        {
+            const coord_def c = *ri;
+
+            // Squares the flood never looked at can't have changed for it.
+            if (checked(c) || !cost(c))
+                continue;
+            checked.set(c);
+
+            const bool was_safe = safe(c);
+            const int old_cost = cost(c);
+            look_up(c);
+            if (safe(c) != was_safe || cost(c) != old_cost)
+                changes.push_back({ c, was_safe, old_cost });
+        }
+    first_view = _run_views.size() - 1;
+
+    if (!changes.empty())
+        repair(changes);
+}
+
+// Is c still as far from the seed as we think, through a neighbour that
+// is? Every step costs something, so support can't go round in circles.
+bool travel_distance_field::supported(const coord_def &c) const
+{
+    if (!safe(c))
+        return false;
+
+    bool found = false;
+    for_each_entry(c, [&](const coord_def &e)
+    {
+        if (dist(e) != INFINITE_DISTANCE && leave_distance(e) == dist(c))
+            found = true;
+    });
+    return found;
+}
+
+// Offers c the best path through its neighbours.
+void travel_distance_field::reenter(const coord_def &c)
+{
+    if (c == key.seed || !safe(c))
+        return;
+
+    int best = dist(c);
+    for_each_entry(c, [&](const coord_def &e)
+    {
+        if (dist(e) != INFINITE_DISTANCE)
+            best = min(best, leave_distance(e));
+    });
+
+    if (best < dist(c))
+    {
+        dist(c) = best;
+        settled.set(c, false);
+        queue.push(coord_dist(c, best));
+    }
+}
+
+void travel_distance_field::repair(const vector<square_change> &changes)
+{
+    // First forget the distances that may have gone through a square that
+    // is now unsafe or slower to leave, and any that went through those.
+    vector<coord_def> suspects;
+    for (const square_change &change : changes)
+    {
+        const coord_def c = change.pos;
+        if (change.was_safe && !safe(c))
+            suspects.push_back(c);
+        if (cost(c) > change.old_cost && dist(c) != INFINITE_DISTANCE)
+        {
+            for_each_exit(c, [&](const coord_def &dc)
+            {
+                if (dist(dc) > dist(c))
+                    suspects.push_back(dc);
+            });
+        }
+    }
+
+    vector<coord_def> lost;
+    while (!suspects.empty())
+    {
+        const coord_def c = suspects.back();
+        suspects.pop_back();
+        if (c == key.seed || dist(c) == INFINITE_DISTANCE || supported(c))
+            continue;
+
+        const int old_dist = dist(c);
+        dist(c) = INFINITE_DISTANCE;
+        settled.set(c, false);
+        lost.push_back(c);
+        for_each_exit(c, [&](const coord_def &dc)
+        {
+            if (dist(dc) != INFINITE_DISTANCE && dist(dc) > old_dist)
+                suspects.push_back(dc);
+        });
+    }
+
+    // Then find new paths to those squares and to newly safe ones, and
+    // let squares that got faster to leave offer shorter paths again.
+    for (const square_change &change : changes)
+    {
+        const coord_def c = change.pos;
+        if (!change.was_safe && safe(c))
+            lost.push_back(c);
+        if (cost(c) < change.old_cost && dist(c) != INFINITE_DISTANCE)
+        {
+            settled.set(c, false);
+            queue.push(coord_dist(c, dist(c)));
+        }
+    }
+
+    for (const coord_def &c : lost)
+        reenter(c);
+}
+
+// The distance fields of the current run, most recently used first. A run
+// rarely needs more than the fields to its next two targets, and their
+// fallbacks.
+static vector<unique_ptr<travel_distance_field>> _distance_fields;
+static const size_t MAX_DISTANCE_FIELDS = 4;
+
+static void _forget_distance_fields()
+{
+    _distance_fields.clear();
+    _run_views.clear();
+}
+
+// Explore doesn't flood through transporters, so its fields leave them out.
+static travel_distance_field &_distance_field_for(const coord_def &seed,
+                                                  bool ignore_danger,
+                                                  bool try_fallback,
+                                                  bool take_transporters)
+{
+    distance_field_key key;
+    key.level = level_id::current();
+    key.seed = seed;
+    key.ignore_danger = ignore_danger;
+    key.try_fallback = try_fallback;
+    key.traversal = _travel_traversal_state();
+    key.exclusions = curr_excludes.generation();
+    if (take_transporters)
+    {
+        key.transporters =
+            travel_cache.get_level_info(key.level).get_transporters();
+    }
+
+    auto it = find_if(_distance_fields.begin(), _distance_fields.end(),
+                      [&key](const unique_ptr<travel_distance_field> &field)
+                      { return field->key == key; });
+    if (it != _distance_fields.end())
+        rotate(_distance_fields.begin(), it, it + 1);
+    else
+    {
+        if (_distance_fields.size() >= MAX_DISTANCE_FIELDS)
+            _distance_fields.pop_back();
+        _distance_fields.insert(_distance_fields.begin(),
+                                make_unique<travel_distance_field>(key));
+    }
+
+    travel_distance_field &field = *_distance_fields.front();
+    field.refresh();
+    return field;
+}
+
+const travel_flood_stats& get_travel_flood_stats()
+{
+    return flood_stats;
+}
+
+void reset_travel_flood_stats()
+{
+    flood_stats = travel_flood_stats();
+}
+
+void set_travel_distance_fields(bool enabled)
+{
+    distance_fields_enabled = enabled;
+}
+
 // already defined in header
 // const int travel_pathfind::UNFOUND_DIST;
 // const int travel_pathfind::INFINITE_DIST;
@@ -1132,7 +1619,8 @@ travel_pathfind::travel_pathfind()
       unexplored_place(), greedy_place(), unexplored_dist(0), greedy_dist(0),
       refdist(nullptr), reseed_points(), features(nullptr), unreachables(),
       point_distance(travel_point_distance), points(0), next_iter_points(0),
-      traveled_distance(0), circ_index(0)
+      traveled_distance(0), circ_index(0), try_fallback(false),
+      use_distance_field(false)
 {
 }
 
@@ -1191,6 +1679,11 @@ void travel_pathfind::set_feature_vector(vector<coord_def> *feats)
     }
 }
 
+void travel_pathfind::set_use_distance_field(bool use)
+{
+    use_distance_field = use;
+}
+
 const coord_def travel_pathfind::travel_move() const
 {
     return next_travel_move;
@@ -1227,6 +1720,8 @@ coord_def travel_pathfind::pathfind(run_mode_type rmode, bool fallback_explore)
 {
     unwind_bool saved_ipt(ignore_player_traversability);
 
+    flood_stats.pathfinds++;
+
     if (rmode == RMODE_INTERLEVEL)
         rmode = RMODE_TRAVEL;
 
@@ -1299,7 +1794,25 @@ coord_def travel_pathfind::pathfind(run_mode_type rmode, bool fallback_explore)
 
     unwind_bool slime_wall_check(g_Slime_Wall_Check,
                                  !actor_slime_wall_immune(&you));
+
+    if (use_distance_field && distance_fields_enabled && !features
+        && !annotate_map)
+    {
+        if (runmode == RMODE_TRAVEL && !floodout)
+            return distance_field_travel_move();
+
+        // With explore_wall_bias, the target depends on the whole flood.
+        if ((runmode == RMODE_EXPLORE || runmode == RMODE_EXPLORE_GREEDY)
+            && floodout && !try_fallback && !Options.explore_wall_bias)
+        {
+            const coord_def target = distance_field_explore_target();
+            if (!target.origin())
+                return target;
+        }
+    }
+
     unwind_slime_wall_precomputer slime_neighbours(g_Slime_Wall_Check);
+    flood_stats.floods++;
 
     // How many points are we currently considering? We start off with just one
     // point, and spread outwards like a flood-filler.
@@ -1411,6 +1924,86 @@ coord_def travel_pathfind::pathfind(run_mode_type rmode, bool fallback_explore)
                                    : explore_target();
 }
 
+// Answers a travel move from the distance field seeded at the destination.
+coord_def travel_pathfind::distance_field_travel_move()
+{
+    const coord_def c = _distance_field_for(start, ignore_danger, try_fallback,
+                                            true).travel_move(dest);
+    if (!c.origin() && _is_safe_move(c))
+        next_travel_move = c;
+    flood_stats.field_answers++;
+    return travel_move();
+}
+
+// Finds the explore target from the distance field seeded at the player,
+// as the first part of the double flood would: the nearest square next to
+// unexplored territory or, for greedy explore, worth a visit. Returns the
+// origin if there's neither, leaving it to the flood to work out why.
+coord_def travel_pathfind::distance_field_explore_target()
+{
+    travel_distance_field &field =
+        _distance_field_for(start, ignore_danger, try_fallback, false);
+
+    const int unexplored_penalty =
+        need_for_greed && Options.explore_item_greed > 0
+            ? Options.explore_item_greed : 0;
+    const int greedy_penalty = max(0, -Options.explore_item_greed);
+
+    vector<coord_def> greedy_squares;
+    FixedBitArray<GXM, GYM> is_greedy;
+    if (need_for_greed && ls)
+    {
+        greedy_squares = ls->squares_needing_visit(autopickup);
+        for (const coord_def &c : greedy_squares)
+            is_greedy.set(c);
+    }
+
+    auto consider = [&](const coord_def &c)
+    {
+        const int dist = field.leave_distance(c);
+        if (_borders_unexplored(c)
+            && (unexplored_dist == UNFOUND_DIST
+                || dist + unexplored_penalty < unexplored_dist))
+        {
+            unexplored_dist = dist + unexplored_penalty;
+            unexplored_place = c;
+        }
+        if (is_greedy(c) && field.is_safe(c)
+            && (greedy_dist == UNFOUND_DIST
+                || dist + greedy_penalty < greedy_dist))
+        {
+            greedy_dist = dist + greedy_penalty;
+            greedy_place = c;
+        }
+    };
+
+    for (const coord_def &c : field.unexplored_borders())
+        if (field.is_settled(c))
+            consider(c);
+    for (const coord_def &c : greedy_squares)
+        if (field.is_settled(c))
+            consider(c);
+
+    // Squares still to be settled are at least one step farther than
+    // unsettled_distance().
+    auto found = [&]()
+    {
+        return min(unexplored_dist == UNFOUND_DIST ? INFINITE_DISTANCE
+                                                   : unexplored_dist,
+                   greedy_dist == UNFOUND_DIST ? INFINITE_DISTANCE
+                                               : greedy_dist);
+    };
+    while (field.unsettled_distance() < found())
+        consider(field.settle_next());
+
+    if (unexplored_dist == UNFOUND_DIST && greedy_dist == UNFOUND_DIST)
+        return coord_def();
+
+    field.export_distances(point_distance);
+    flood_stats.field_answers++;
+    return explore_target();
+}
+
 void travel_pathfind::get_features()
 {
     ASSERT(features);
@@ -1614,7 +2207,8 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
     {
         return false;
     }
-    else if (dc == dest)
+
+    if (dc == dest)
     {
         // Hallelujah, we're home!
         if (_is_safe_move(c))
@@ -1803,7 +2397,10 @@ void find_travel_pos(const coord_def& youpos,
     travel_pathfind tp;
 
     if (need_move)
+    {
         tp.set_src_dst(youpos, you.running.pos);
+        tp.set_use_distance_field(true);
+    }
     else
         tp.set_floodseed(youpos);
 
@@ -4496,6 +5093,7 @@ void runrest::stop(bool clear_delays)
         (runmode > 0 || runmode < 0 && Options.travel_delay == -1);
     _userdef_run_stoprunning_hook();
     runmode = RMODE_NOT_RUNNING;
+    _forget_distance_fields();
 
     // Kill the delay; this is fine because it's not possible to stack
     // run/rest/travel on top of other delays.
@@ -511,6 +511,10 @@ public:
     // Set feature vector to use; if non-nullptr, also sets annotate_map to true.
     void set_feature_vector(vector<coord_def> *features);
 
+    // Allow travel and explore to answer from distance fields kept for the
+    // rest of the run, instead of flooding from scratch.
+    void set_use_distance_field(bool use);
+
     // Extract features without pathfinding
     void get_features();
 
@@ -546,6 +550,8 @@ protected:
     bool square_slows_movement(const coord_def &c);
     void check_square_greed(const coord_def &c);
     void good_square(const coord_def &c);
+    coord_def distance_field_travel_move();
+    coord_def distance_field_explore_target();
 
 protected:
     static const int UNFOUND_DIST  = -30000;
@@ -628,8 +634,23 @@ protected:
     // Attempt to path through temporary obstructions (like sealed doors)
     // due to the possibility they are no longer obstructing us
     bool try_fallback;
+
+    // Whether travel and explore may use distance fields.
+    bool use_distance_field;
+};
+
+struct travel_flood_stats
+{
+    uint64_t pathfinds = 0;      // calls to travel_pathfind::pathfind()
+    uint64_t floods = 0;         // pathfinds that flooded from scratch
+    uint64_t field_answers = 0;  // queries answered from a distance field
+    uint64_t field_settled = 0;  // squares distance fields settled
 };
 
+const travel_flood_stats& get_travel_flood_stats();
+void reset_travel_flood_stats();
+void set_travel_distance_fields(bool enabled);
+
 extern TravelCache travel_cache;
 
 void do_interlevel_travel();
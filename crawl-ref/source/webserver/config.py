@@ -131,6 +131,11 @@ max_idle_time = 5 * 60 * 60
 
 use_gzip = True
 
+# Ask crawl to send map updates in a compact binary encoding instead of JSON.
+# This saves bandwidth and CPU on busy servers; versions of crawl that don't
+# know about it just keep sending JSON.
+binary_map_protocol = False
+
 # Seconds until stale HTTP connections are closed
 # This needs a patch currently not in mainline tornado.
 http_connection_timeout = None
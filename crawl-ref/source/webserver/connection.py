@@ -13,6 +13,7 @@ from tornado.escape import to_unicode
 from tornado.escape import utf8
 from tornado.ioloop import IOLoop
 
+import config
 from config import server_socket_path
 
 
@@ -71,7 +72,8 @@ class WebtilesSocketConnection(object):
 
         msg = json_encode({
                 "msg": "attach",
-                "primary": primary
+                "primary": primary,
+                "binary_map": getattr(config, "binary_map_protocol", False)
                 })
 
         self.open = True
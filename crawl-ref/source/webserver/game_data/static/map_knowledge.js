@@ -2,6 +2,9 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
     "use strict";
 
     var k, player_on_level, monster_table, dirty_locs, bounds, bounds_changed;
+    // Raw [lo, hi] fg, bg and cloud indices of each cell, which binary map
+    // updates are relative to.
+    var tile_bases;
 
     function init()
     {
@@ -10,6 +13,7 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
         dirty_locs = [];
         bounds = null;
         bounds_changed = false;
+        tile_bases = {};
     }
 
     $(document).bind("game_init", init);
@@ -35,6 +39,7 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
         k = new Array(65536);
         monster_table = {};
         bounds = null;
+        tile_bases = {};
     }
 
     function visible(cell)
@@ -197,6 +202,113 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
 
     }
 
+    // Binary map encoding, see _send_cell() in tileweb.cc
+    var BINARY_MAP_VERSION = 1;
+    var TILE_FIELDS = ["fg", "bg", "cloud"];
+    var TILE_FLAG_UNSEEN = 0x00040000;
+    var CELL_FLAGS = ["bloody", "old_blood", "silenced",
+                      "highlighted_summoner", "sanctuary", "liquefied",
+                      "quad_glow", "disjunct", "mangrove_water",
+                      "awakened_forest"];
+    var SMALL_INT_FIELDS = ["halo", "orb_glow", "blood_rotation",
+                            "travel_trail"];
+
+    function decode_binary(data)
+    {
+        var bytes = atob(data), pos = 0;
+
+        function varint()
+        {
+            var val = 0, mul = 1, b;
+            do
+            {
+                b = bytes.charCodeAt(pos++);
+                val += (b & 0x7f) * mul;
+                mul *= 128;
+            }
+            while (b & 0x80);
+            return val;
+        }
+
+        function unzigzag(val)
+        {
+            return val % 2 ? -(val + 1) / 2 : val / 2;
+        }
+
+        function tile(base, i)
+        {
+            var val = varint();
+            var hi_changed = val % 2;
+            base[i] = (base[i] + unzigzag((val - hi_changed) / 2)) | 0;
+            if (hi_changed)
+                base[i + 1] = varint() | 0;
+            return base[i + 1] ? [base[i], base[i + 1]] : base[i];
+        }
+
+        if (varint() != BINARY_MAP_VERSION)
+            throw new Error("Unknown binary map version");
+        var gxm = varint();
+        var origin_x = unzigzag(varint()), origin_y = unzigzag(varint());
+
+        var cells = [], index = -1;
+        while (pos < bytes.length)
+        {
+            index += varint() + 1;
+            var mask = varint(), i;
+            var cell = {
+                x: index % gxm - origin_x,
+                y: Math.floor(index / gxm) - origin_y
+            };
+            var t = {};
+
+            if (mask & 1)
+                cell.f = varint();
+            if (mask & 2)
+                cell.mf = varint();
+            if (mask & 4)
+                cell.g = String.fromCodePoint(varint());
+            if (mask & 8)
+                cell.col = varint();
+
+            var key = util.make_key(cell.x, cell.y);
+            var base = tile_bases[key];
+            if (!base)
+                base = tile_bases[key] = [0, 0, TILE_FLAG_UNSEEN, 0, 0, 0];
+            for (i = 0; i < TILE_FIELDS.length; ++i)
+                if (mask & (0x10 << i))
+                    t[TILE_FIELDS[i]] = tile(base, 2 * i);
+
+            if (mask & 0x80)
+            {
+                var flags = varint();
+                for (i = 0; i < CELL_FLAGS.length; ++i)
+                    t[CELL_FLAGS[i]] = (flags & (1 << i)) != 0;
+            }
+            for (i = 0; i < SMALL_INT_FIELDS.length; ++i)
+                if (mask & (0x100 << i))
+                    t[SMALL_INT_FIELDS[i]] = unzigzag(varint());
+            if (mask & 0x1000)
+            {
+                t.flv = { f: varint() };
+                var special = varint();
+                if (special)
+                    t.flv.s = special;
+            }
+            if (mask & 0x2000)
+            {
+                var count = varint();
+                t.ov = [];
+                for (i = 0; i < count; ++i)
+                    t.ov.push(varint());
+            }
+
+            if (mask & ~0xf)
+                cell.t = t;
+            cells.push(cell);
+        }
+        return cells;
+    }
+
     function merge_diff(vals)
     {
         $.each(vals, function (i, val)
@@ -210,6 +322,7 @@ define(["jquery", "./enums", "./util"], function ($, enums, util) {
     return {
         get: get,
         merge: merge_diff,
+        merge_binary: function (data) { merge_diff(decode_binary(data)); },
         clear: clear,
         touch: touch,
         visible: visible,
@@ -205,6 +205,57 @@ function ($, comm, client, ui, enums, cr, util, options, scroller) {
             menu.last_present = end;
     }
 
+    function reset_items()
+    {
+        // Turn every item back into a placeholder; the server resends the
+        // ones in view, and the rest are requested again when needed.
+        for (var i = 0; i < menu.items.length; ++i)
+        {
+            var old_item = menu.items[i];
+            if (!old_item) continue;
+            var item = {
+                level: 2,
+                text: "...",
+                index: i,
+                elem: old_item.elem
+            };
+            item.elem.data("item", item);
+            item.elem.removeClass();
+            item.elem.addClass("placeholder");
+            item.elem.html("...");
+            menu.items[i] = item;
+        }
+    }
+
+    function request_missing_items()
+    {
+        // Long menus are sent a page at a time, so ask for any placeholders
+        // near the visible items.
+        if (client.is_watching()) return;
+
+        var overscan = 50;
+        var start = Math.max(menu.first_visible - overscan, 0);
+        var end = Math.min(Math.max(menu.last_visible, menu.first_visible)
+                           + overscan, menu.total_items - 1);
+        while (start <= end && !is_unrequested(menu.items[start]))
+            start++;
+        while (start <= end && !is_unrequested(menu.items[end]))
+            end--;
+        if (start > end) return;
+
+        for (var i = start; i <= end; ++i)
+            menu.items[i].requested = true;
+        comm.send_message("*request_menu_range", {
+            start: start,
+            end: end
+        });
+    }
+
+    function is_unrequested(item)
+    {
+        return item && item.elem.hasClass("placeholder") && !item.requested;
+    }
+
     function update_item_range(chunk_start, items_list)
     {
         prepare_item_range(0, menu.total_items-1);
@@ -435,6 +486,11 @@ function ($, comm, client, ui, enums, cr, util, options, scroller) {
     function update_menu(data)
     {
         $.extend(menu, data);
+        if (menu.reset_items)
+        {
+            delete menu.reset_items;
+            reset_items();
+        }
 
         var old_length = menu.items.length;
         menu.items.length = menu.total_items;
@@ -505,6 +561,7 @@ function ($, comm, client, ui, enums, cr, util, options, scroller) {
             menu.following_player_scroll = false;
 
         update_visible_indices();
+        request_missing_items();
         schedule_server_scroll();
     }
 